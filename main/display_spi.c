@@ -0,0 +1,200 @@
+#include <assert.h>
+#include <string.h>
+#include <driver/gpio.h>
+#include <driver/spi_master.h>
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <hal/gpio_ll.h>
+
+#include "display_spi.h"
+
+#define SPI_QUEUE_DEPTH     24      // a full frame is 16 transactions on SH1106/SSD1306
+#define SPI_TRANS_MAX       132     // one page of 128 columns plus slack
+
+static const char *TAG = "display_spi";
+
+static display_spi_config spi_config;
+static spi_device_handle_t device;
+static spi_transaction_t slots[SPI_QUEUE_DEPTH];
+static uint8_t* slot_buffers;
+static int next_slot = 0, in_flight = 0;
+static spi_transaction_t* current = NULL;
+static uint8_t dc_level = 0;
+static volatile int64_t trans_start;
+static display_spi_stats stats;
+
+//runs in the SPI ISR, which stays live while flash writes disable the cache, so
+//only inline register writes and IRAM functions like esp_timer_get_time in here
+static void IRAM_ATTR pre_transfer(spi_transaction_t* trans)
+{
+    gpio_ll_set_level(&GPIO, spi_config.dc, (int)(intptr_t)trans->user);
+    trans_start = esp_timer_get_time();
+}
+
+static void IRAM_ATTR post_transfer(spi_transaction_t* trans)
+{
+    stats.wire_us += esp_timer_get_time() - trans_start;
+}
+
+void display_spi_init(const display_spi_config* config)
+{
+    spi_config = *config;
+
+    spi_bus_config_t bus = {
+        .sclk_io_num = config->clk,
+        .mosi_io_num = config->mosi,
+        .miso_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = SPI_TRANS_MAX,
+    };
+    spi_device_interface_config_t dev = {
+        .clock_speed_hz = config->clock_hz,
+        .mode = 0,
+        .spics_io_num = config->cs,
+        .queue_size = SPI_QUEUE_DEPTH,
+        .pre_cb = pre_transfer,
+        .post_cb = post_transfer,
+    };
+    ESP_ERROR_CHECK(spi_bus_initialize(config->host, &bus, SPI_DMA_CH_AUTO));
+    ESP_ERROR_CHECK(spi_bus_add_device(config->host, &dev, &device));
+
+    slot_buffers = heap_caps_malloc(SPI_QUEUE_DEPTH * SPI_TRANS_MAX, MALLOC_CAP_DMA);
+    assert(slot_buffers);
+
+    gpio_reset_pin(config->dc);
+    gpio_set_direction(config->dc, GPIO_MODE_OUTPUT);
+    if(config->reset >= 0)
+    {
+        gpio_reset_pin(config->reset);
+        gpio_set_direction(config->reset, GPIO_MODE_OUTPUT);
+        gpio_set_level(config->reset, 1);
+    }
+    ESP_LOGI(TAG, "spi display at %d Hz", config->clock_hz);
+}
+
+//slots complete in queue order, so reaping the oldest result frees the next slot
+static void reap(int keep)
+{
+    while(in_flight > keep)
+    {
+        spi_transaction_t* done;
+        int64_t start = esp_timer_get_time();
+        spi_device_get_trans_result(device, &done, portMAX_DELAY);
+        stats.blocked_us += esp_timer_get_time() - start;
+        in_flight--;
+    }
+}
+
+static void begin_transaction()
+{
+    reap(SPI_QUEUE_DEPTH - 1);
+    current = &slots[next_slot];
+    memset(current, 0, sizeof(*current));
+    current->tx_buffer = slot_buffers + next_slot * SPI_TRANS_MAX;
+    current->user = (void*)(intptr_t)dc_level;
+}
+
+static void queue_transaction()
+{
+    if(current && current->length)
+    {
+        stats.transactions++;
+        stats.bytes += current->length / 8;
+        spi_device_queue_trans(device, current, portMAX_DELAY);
+        in_flight++;
+        next_slot = (next_slot + 1) % SPI_QUEUE_DEPTH;
+    }
+    current = NULL;
+}
+
+uint8_t display_spi_byte_cb(u8x8_t* u8x8, uint8_t msg, uint8_t arg_int, void* arg_ptr)
+{
+    switch(msg)
+    {
+        case U8X8_MSG_BYTE_SET_DC:
+            //a DC change inside a transfer splits it, the pin follows each transaction
+            if(current && current->length && dc_level != arg_int)
+            {
+                queue_transaction();
+                dc_level = arg_int;
+                begin_transaction();
+            }
+            dc_level = arg_int;
+            if(current)
+                current->user = (void*)(intptr_t)dc_level;
+            break;
+        case U8X8_MSG_BYTE_START_TRANSFER:
+            begin_transaction();
+            break;
+        case U8X8_MSG_BYTE_SEND:
+        {
+            //sending outside a transfer has nowhere to go
+            if(!current)
+                return 0;
+            const uint8_t* data = arg_ptr;
+            while(arg_int > 0)
+            {
+                int used = current->length / 8;
+                if(used == SPI_TRANS_MAX)
+                {
+                    queue_transaction();
+                    begin_transaction();
+                    used = 0;
+                }
+                int chunk = (arg_int < SPI_TRANS_MAX - used) ? arg_int : SPI_TRANS_MAX - used;
+                memcpy((uint8_t*)current->tx_buffer + used, data, chunk);
+                current->length += chunk * 8;
+                data += chunk;
+                arg_int -= chunk;
+            }
+            break;
+        }
+        case U8X8_MSG_BYTE_END_TRANSFER:
+            if(!current)
+                return 0;
+            queue_transaction();
+            break;
+        default:
+            break;
+    }
+    return 1;
+}
+
+uint8_t display_spi_gpio_and_delay_cb(u8x8_t* u8x8, uint8_t msg, uint8_t arg_int, void* arg_ptr)
+{
+    switch(msg)
+    {
+        case U8X8_MSG_GPIO_RESET:
+            if(spi_config.reset >= 0)
+                gpio_set_level(spi_config.reset, arg_int);
+            break;
+        case U8X8_MSG_DELAY_MILLI:
+            vTaskDelay((arg_int + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+            break;
+        case U8X8_MSG_DELAY_10MICRO:
+            esp_rom_delay_us(10 * arg_int);
+            break;
+        case U8X8_MSG_DELAY_100NANO:
+            esp_rom_delay_us(1);
+            break;
+        default:
+            break;
+    }
+    return 1;
+}
+
+void display_spi_flush(void)
+{
+    reap(0);
+}
+
+const display_spi_stats* display_spi_get_stats(void)
+{
+    return &stats;
+}
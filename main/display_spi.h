@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <u8g2.h>
+
+// u8x8 byte callback for 4-wire SPI panels (SH1106/SSD1306) that queues every
+// transfer as a DMA transaction instead of waiting for it. u8g2_SendBuffer
+// returns as soon as the pages are queued and the wire time overlaps the next
+// frame's game logic. DC is switched per transaction from the pre-transfer hook.
+
+typedef struct display_spi_config
+{
+    int host;               // spi_host_device_t
+    int clk, mosi, cs, dc, reset;
+    int clock_hz;
+} display_spi_config;
+
+typedef struct display_spi_stats
+{
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t wire_us;       // time transactions spent on the bus
+    uint32_t blocked_us;    // time callers waited for a free transaction slot
+} display_spi_stats;
+
+void display_spi_init(const display_spi_config* config);
+
+uint8_t display_spi_byte_cb(u8x8_t* u8x8, uint8_t msg, uint8_t arg_int, void* arg_ptr);
+uint8_t display_spi_gpio_and_delay_cb(u8x8_t* u8x8, uint8_t msg, uint8_t arg_int, void* arg_ptr);
+
+// Blocks until everything queued has gone out, e.g. before sleeping.
+void display_spi_flush(void);
+
+const display_spi_stats* display_spi_get_stats(void);
@@ -0,0 +1,72 @@
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+
+#include "level_pack.h"
+
+static const char *TAG = "level_pack";
+
+static const level_pack_header* pack = NULL;
+static esp_partition_mmap_handle_t pack_handle;
+
+static bool level_valid(const level_pack_header* header, uint32_t offset)
+{
+    const snake_level* level = (const snake_level*)((const uint8_t*)header + offset);
+    uint32_t end = sizeof(level_pack_header) + header->size;
+    if(offset % 4 || offset < sizeof(level_pack_header) || offset + sizeof(snake_level) > end)
+        return false;
+    if(level->width < LEVEL_MIN_WIDTH || level->width > LEVEL_MAX_SIZE ||
+        level->height < 1 || level->height > LEVEL_MAX_SIZE ||
+        level->spawn_x >= level->width || level->spawn_y >= level->height)
+        return false;
+    return offset + sizeof(snake_level) + (level->width * level->height + 7) / 8 <= end;
+}
+
+int level_pack_open(void)
+{
+    if(pack)
+        return pack->level_count;
+
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+        LEVEL_PACK_SUBTYPE, "levels");
+    if(!partition)
+    {
+        ESP_LOGW(TAG, "no levels partition, playing on the empty map");
+        return 0;
+    }
+
+    const void* data;
+    if(esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA,
+        &data, &pack_handle) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "failed to map levels partition");
+        return 0;
+    }
+
+    const level_pack_header* header = data;
+    bool valid = header->magic == LEVEL_PACK_MAGIC && header->version == LEVEL_PACK_VERSION &&
+        header->size >= header->level_count * sizeof(uint32_t) &&
+        sizeof(level_pack_header) + header->size <= partition->size &&
+        esp_rom_crc32_le(0, (const uint8_t*)(header + 1), header->size) == header->crc32;
+    const uint32_t* offsets = (const uint32_t*)(header + 1);
+    for(int i = 0; valid && i < header->level_count; i++)
+        valid = level_valid(header, offsets[i]);
+    if(!valid)
+    {
+        ESP_LOGW(TAG, "levels partition holds no valid pack");
+        esp_partition_munmap(pack_handle);
+        return 0;
+    }
+
+    pack = header;
+    ESP_LOGI(TAG, "mapped %d levels", pack->level_count);
+    return pack->level_count;
+}
+
+const snake_level* level_pack_get(int index)
+{
+    if(!pack || index < 0 || index >= pack->level_count)
+        return NULL;
+    const uint32_t* offsets = (const uint32_t*)(pack + 1);
+    return (const snake_level*)((const uint8_t*)pack + offsets[index]);
+}
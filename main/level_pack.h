@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Level pack layout (little endian), written by tools/levelpack.py:
+//   level_pack_header
+//   level_count * uint32_t offsets of the levels from the start of the pack
+//   snake_level records, each 4 byte aligned
+// Walls are a row-major bitmap, bit (y * width + x) LSB first, y = 0 at the bottom.
+
+#define LEVEL_PACK_MAGIC     0x4C4B4E53  // "SNKL"
+#define LEVEL_PACK_VERSION   2
+#define LEVEL_PACK_SUBTYPE   0x40
+#define LEVEL_NAME_LEN       16
+#define LEVEL_MIN_WIDTH      5           // the spawn needs the body and one step of room
+#define LEVEL_MAX_SIZE       256
+
+typedef struct __attribute__((packed)) level_pack_header
+{
+    uint32_t magic;
+    uint8_t version;
+    uint8_t level_count;
+    uint16_t reserved;
+    uint32_t size;          // bytes following the header
+    uint32_t crc32;         // zlib crc32 over those bytes
+} level_pack_header;
+
+typedef struct __attribute__((packed)) snake_level
+{
+    char name[LEVEL_NAME_LEN];
+    uint16_t width;
+    uint16_t height;
+    uint16_t spawn_x;
+    uint16_t spawn_y;
+    uint16_t tick_ms;       // 0 = game default
+    uint8_t apple_score;    // 0 = game default
+    uint8_t reserved;
+    uint8_t walls[];
+} snake_level;
+
+// Maps the "levels" partition and validates every level in it.
+// Returns the number of levels available, 0 if there is no usable pack.
+int level_pack_open(void);
+
+// Returns a pointer straight into mapped flash, nothing is copied.
+const snake_level* level_pack_get(int index);
+
+static inline bool level_is_wall(const snake_level* level, int x, int y)
+{
+    if(!level)
+        return false;
+    int bit = y * level->width + x;
+    return (level->walls[bit >> 3] >> (bit & 7)) & 1;
+}
@@ -0,0 +1,446 @@
+#include <string.h>
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "score_log.h"
+
+#define SECTOR_MAGIC        0x534B4E53  // "SNKS"
+#define RECORD_MAGIC        0x5352
+#define RECORD_FLAG_REPLAY  1
+#define MAX_SECTORS         64
+#define MIN_FREE_SECTORS    2
+#define ALIGN4(x)           (((x) + 3) & ~3)
+
+typedef struct __attribute__((packed)) sector_header
+{
+    uint32_t magic;
+    uint32_t gen;
+    uint32_t reserved;
+    uint32_t crc;           // over the fields above
+} sector_header;
+
+typedef struct __attribute__((packed)) record_header
+{
+    uint16_t magic;
+    uint16_t len;           // payload bytes following the header
+    uint32_t seq;
+    uint32_t score;
+    uint8_t level;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t payload_crc;
+    uint32_t crc;           // over the fields above, checked at boot without touching the payload
+} record_header;
+
+typedef struct __attribute__((packed)) replay_payload
+{
+    uint32_t seed;
+    uint16_t step_count;
+    uint16_t steps[];
+} replay_payload;
+
+static const char *TAG = "score_log";
+
+static const esp_partition_t* partition = NULL;
+static const uint8_t* flash;
+static esp_partition_mmap_handle_t flash_handle;
+static uint32_t sector_size;
+static int sector_count;
+static uint32_t sector_gen[MAX_SECTORS];   // 0 = free
+static int active_sector = -1;
+static uint32_t write_offset;
+static uint32_t next_gen = 1, next_seq = 1;
+
+static score_entry top[SCORE_LOG_TOP_N];
+static int top_count = 0;
+
+static SemaphoreHandle_t lock;
+static TaskHandle_t compact_task;
+static score_log_stats stats;
+
+static bool region_blank(uint32_t offset, uint32_t len)
+{
+    for(uint32_t i = 0; i < len; i++)
+        if(flash[offset + i] != 0xFF)
+            return false;
+    return true;
+}
+
+static bool sector_header_valid(const sector_header* header)
+{
+    return header->magic == SECTOR_MAGIC && header->gen != 0 &&
+        header->crc == esp_rom_crc32_le(0, (const uint8_t*)header, offsetof(sector_header, crc));
+}
+
+static bool record_header_valid(const record_header* header, uint32_t offset)
+{
+    return header->magic == RECORD_MAGIC &&
+        offset + sizeof(record_header) + header->len <= sector_size &&
+        header->crc == esp_rom_crc32_le(0, (const uint8_t*)header, offsetof(record_header, crc));
+}
+
+static bool entry_better(uint32_t score, uint32_t seq, const score_entry* other)
+{
+    return score > other->score || (score == other->score && seq < other->seq);
+}
+
+static void index_insert(const record_header* header, int sector, uint32_t offset)
+{
+    //a relocated copy of a record keeps its seq, only its location moves
+    for(int i = 0; i < top_count; i++)
+        if(top[i].seq == header->seq)
+        {
+            top[i].sector = sector;
+            top[i].offset = offset;
+            return;
+        }
+
+    int pos = top_count;
+    while(pos > 0 && entry_better(header->score, header->seq, &top[pos - 1]))
+        pos--;
+    if(pos >= SCORE_LOG_TOP_N)
+        return;
+
+    int last = (top_count < SCORE_LOG_TOP_N) ? top_count : SCORE_LOG_TOP_N - 1;
+    memmove(&top[pos + 1], &top[pos], (last - pos) * sizeof(score_entry));
+    top[pos] = (score_entry){
+        .seq = header->seq, .score = header->score, .level = header->level,
+        .has_replay = header->flags & RECORD_FLAG_REPLAY,
+        .sector = sector, .offset = offset, .len = header->len,
+    };
+    if(top_count < SCORE_LOG_TOP_N)
+        top_count++;
+}
+
+static int free_sectors()
+{
+    int count = 0;
+    for(int i = 0; i < sector_count; i++)
+        if(!sector_gen[i])
+            count++;
+    return count;
+}
+
+static esp_err_t flash_write(uint32_t offset, const void* data, uint32_t len)
+{
+    stats.flash_bytes += len;
+    return esp_partition_write(partition, offset, data, len);
+}
+
+static esp_err_t open_sector(int sector)
+{
+    uint32_t base = sector * sector_size;
+    if(!region_blank(base, sector_size))
+    {
+        esp_err_t err = esp_partition_erase_range(partition, base, sector_size);
+        if(err != ESP_OK)
+            return err;
+        stats.erases++;
+    }
+
+    sector_header header = { .magic = SECTOR_MAGIC, .gen = next_gen };
+    header.crc = esp_rom_crc32_le(0, (const uint8_t*)&header, offsetof(sector_header, crc));
+    esp_err_t err = flash_write(base, &header, sizeof(header));
+    if(err != ESP_OK)
+        return err;
+
+    sector_gen[sector] = next_gen++;
+    active_sector = sector;
+    write_offset = sizeof(sector_header);
+    return ESP_OK;
+}
+
+static void compact_locked();
+
+//finds room for a record in the active sector, rolling over to the next free one
+static esp_err_t reserve(uint32_t len, bool relocating)
+{
+    if(active_sector >= 0 && write_offset + len <= sector_size)
+        return ESP_OK;
+    if(len > sector_size - sizeof(sector_header))
+        return ESP_ERR_INVALID_SIZE;
+
+    //the last free sector is kept for relocations so compaction can always make progress
+    if(!relocating && free_sectors() < MIN_FREE_SECTORS)
+        compact_locked();
+    if(free_sectors() < (relocating ? 1 : MIN_FREE_SECTORS))
+        return ESP_ERR_NO_MEM;
+
+    int start = (active_sector < 0) ? 0 : active_sector + 1;
+    for(int i = 0; i < sector_count; i++)
+    {
+        int sector = (start + i) % sector_count;
+        if(!sector_gen[sector])
+        {
+            esp_err_t err = open_sector(sector);
+            if(err == ESP_OK && compact_task && free_sectors() < MIN_FREE_SECTORS)
+                xTaskNotifyGive(compact_task);
+            return err;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+static esp_err_t relocate(score_entry* entry)
+{
+    uint32_t len = ALIGN4(sizeof(record_header) + entry->len);
+    esp_err_t err = reserve(len, true);
+    if(err != ESP_OK)
+        return err;
+
+    //copy through RAM since flash writes can't source from mapped flash, header last like an append
+    uint8_t buf[128];
+    uint32_t src = entry->sector * sector_size + entry->offset;
+    uint32_t dst = active_sector * sector_size + write_offset;
+    for(uint32_t done = sizeof(record_header); done < len; done += sizeof(buf))
+    {
+        uint32_t chunk = (len - done < sizeof(buf)) ? len - done : sizeof(buf);
+        memcpy(buf, flash + src + done, chunk);
+        err = flash_write(dst + done, buf, chunk);
+        if(err != ESP_OK)
+            return err;
+    }
+    memcpy(buf, flash + src, sizeof(record_header));
+    err = flash_write(dst, buf, sizeof(record_header));
+    if(err != ESP_OK)
+        return err;
+
+    entry->sector = active_sector;
+    entry->offset = write_offset;
+    write_offset += len;
+    return ESP_OK;
+}
+
+static void compact_locked()
+{
+    for(int pass = 0; pass < sector_count && free_sectors() < MIN_FREE_SECTORS; pass++)
+    {
+        int oldest = -1;
+        for(int i = 0; i < sector_count; i++)
+            if(sector_gen[i] && i != active_sector &&
+                (oldest < 0 || sector_gen[i] < sector_gen[oldest]))
+                oldest = i;
+        if(oldest < 0)
+            return;
+
+        for(int i = 0; i < top_count; i++)
+            if(top[i].sector == oldest && relocate(&top[i]) != ESP_OK)
+            {
+                ESP_LOGE(TAG, "relocation out of sector %d failed", oldest);
+                return;
+            }
+
+        if(esp_partition_erase_range(partition, oldest * sector_size, sector_size) != ESP_OK)
+            return;
+        stats.erases++;
+        sector_gen[oldest] = 0;
+        if(stats.user_bytes)
+            ESP_LOGD(TAG, "sector %d reclaimed, write amplification %d%%, %d erases", oldest,
+                (int)(100ULL * stats.flash_bytes / stats.user_bytes), (int)stats.erases);
+    }
+}
+
+static void compact_task_main(void* arg)
+{
+    while(true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        score_log_compact();
+    }
+}
+
+static void scan_sector(int sector)
+{
+    uint32_t base = sector * sector_size;
+    uint32_t offset = sizeof(sector_header);
+    while(offset + sizeof(record_header) <= sector_size)
+    {
+        const record_header* header = (const record_header*)(flash + base + offset);
+        if(!record_header_valid(header, offset))
+            break;
+        index_insert(header, sector, offset);
+        if(header->seq >= next_seq)
+            next_seq = header->seq + 1;
+        offset += ALIGN4(sizeof(record_header) + header->len);
+    }
+
+    //a torn write leaves garbage after the last good record, never write over it
+    write_offset = region_blank(base + offset, sector_size - offset) ? offset : sector_size;
+}
+
+esp_err_t score_log_init(void)
+{
+    if(partition)
+        return ESP_OK;
+
+    int64_t start = esp_timer_get_time();
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, SCORE_LOG_SUBTYPE, "scores");
+    if(!partition)
+    {
+        ESP_LOGW(TAG, "no scores partition, leaderboard is not kept");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    sector_size = partition->erase_size;
+    sector_count = partition->size / sector_size;
+    if(sector_count < MIN_FREE_SECTORS + 2 || sector_count > MAX_SECTORS)
+    {
+        partition = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const void* data;
+    esp_err_t err = esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA,
+        &data, &flash_handle);
+    if(err != ESP_OK)
+    {
+        partition = NULL;
+        return err;
+    }
+    flash = data;
+
+    //sectors without a valid header are free, erased lazily before reuse
+    int order[MAX_SECTORS];
+    int used = 0;
+    for(int i = 0; i < sector_count; i++)
+    {
+        const sector_header* header = (const sector_header*)(flash + i * sector_size);
+        sector_gen[i] = sector_header_valid(header) ? header->gen : 0;
+        if(!sector_gen[i])
+            continue;
+        if(sector_gen[i] >= next_gen)
+            next_gen = sector_gen[i] + 1;
+
+        int pos = used++;
+        while(pos > 0 && sector_gen[order[pos - 1]] > sector_gen[i])
+        {
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = i;
+    }
+
+    //replay the log oldest first so relocated copies end up at their newest location
+    for(int i = 0; i < used; i++)
+        scan_sector(order[i]);
+    stats.records = top_count;
+    active_sector = used ? order[used - 1] : -1;
+
+    lock = xSemaphoreCreateMutex();
+    xTaskCreate(compact_task_main, "score_log", 3072, NULL, 1, &compact_task);
+
+    stats.boot_us = esp_timer_get_time() - start;
+    ESP_LOGI(TAG, "%d records in %d sectors indexed in %d us", (int)stats.records, used,
+        (int)stats.boot_us);
+    if(free_sectors() < MIN_FREE_SECTORS && compact_task)
+        xTaskNotifyGive(compact_task);
+    return ESP_OK;
+}
+
+int score_log_top(const score_entry** entries)
+{
+    *entries = top;
+    return top_count;
+}
+
+bool score_log_qualifies(uint32_t score)
+{
+    return score > 0 && (top_count < SCORE_LOG_TOP_N || score > top[top_count - 1].score);
+}
+
+esp_err_t score_log_add(uint32_t score, uint8_t level, const snake_replay* replay)
+{
+    if(!partition)
+        return ESP_ERR_INVALID_STATE;
+
+    //the payload is built in RAM so the header can carry its crc
+    uint16_t step_count = (replay && replay->complete) ? replay->step_count : 0;
+    uint32_t payload_len = sizeof(replay_payload) + step_count * sizeof(uint16_t);
+    static uint8_t payload_buf[sizeof(replay_payload) + SNAKE_REPLAY_MAX_STEPS * sizeof(uint16_t)];
+    replay_payload* payload = (replay_payload*)payload_buf;
+    payload->seed = replay ? replay->seed : 0;
+    payload->step_count = step_count;
+    if(step_count)
+        memcpy(payload->steps, replay->steps, step_count * sizeof(uint16_t));
+
+    record_header header = {
+        .magic = RECORD_MAGIC, .len = payload_len, .score = score, .level = level,
+        .flags = (replay && replay->complete) ? RECORD_FLAG_REPLAY : 0,
+        .payload_crc = esp_rom_crc32_le(0, payload_buf, payload_len),
+    };
+    uint32_t len = ALIGN4(sizeof(record_header) + payload_len);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    header.seq = next_seq++;
+    header.crc = esp_rom_crc32_le(0, (const uint8_t*)&header, offsetof(record_header, crc));
+
+    esp_err_t err = reserve(len, false);
+    if(err == ESP_OK)
+    {
+        //payload first, a record only exists once its header lands
+        uint32_t offset = active_sector * sector_size + write_offset;
+        err = flash_write(offset + sizeof(record_header), payload_buf, payload_len);
+        if(err == ESP_OK)
+            err = flash_write(offset, &header, sizeof(header));
+        if(err == ESP_OK)
+        {
+            index_insert(&header, active_sector, write_offset);
+            stats.user_bytes += sizeof(header) + payload_len;
+        }
+        write_offset += len;
+    }
+    xSemaphoreGive(lock);
+
+    if(err != ESP_OK)
+        ESP_LOGE(TAG, "append failed: %s", esp_err_to_name(err));
+    return err;
+}
+
+esp_err_t score_log_load_replay(const score_entry* entry, snake_replay* replay)
+{
+    if(!partition || !entry->has_replay)
+        return ESP_ERR_NOT_FOUND;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    const record_header* header = (const record_header*)(flash + entry->sector * sector_size +
+        entry->offset);
+    const uint8_t* data = (const uint8_t*)(header + 1);
+    esp_err_t err = ESP_OK;
+    const replay_payload* payload = (const replay_payload*)data;
+    if(header->seq != entry->seq || esp_rom_crc32_le(0, data, header->len) != header->payload_crc)
+        err = ESP_ERR_INVALID_CRC;
+    else if(header->len < sizeof(replay_payload) || payload->step_count > SNAKE_REPLAY_MAX_STEPS ||
+        sizeof(replay_payload) + payload->step_count * sizeof(uint16_t) > header->len)
+        err = ESP_ERR_INVALID_SIZE;
+    else
+    {
+        replay->seed = payload->seed;
+        replay->step_count = payload->step_count;
+        replay->complete = true;
+        memcpy(replay->steps, payload->steps, payload->step_count * sizeof(uint16_t));
+    }
+    xSemaphoreGive(lock);
+    return err;
+}
+
+bool score_log_needs_compaction(void)
+{
+    return partition && free_sectors() < MIN_FREE_SECTORS;
+}
+
+void score_log_compact(void)
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    compact_locked();
+    xSemaphoreGive(lock);
+}
+
+const score_log_stats* score_log_get_stats(void)
+{
+    return &stats;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+// Append-only leaderboard log on the "scores" partition. Every sector starts
+// with a header carrying its generation, records follow back to back and are
+// never rewritten. Only the top SCORE_LOG_TOP_N records are live, the rest is
+// garbage reclaimed by copying live records forward and erasing old sectors.
+
+#define SCORE_LOG_SUBTYPE       0x41
+#define SCORE_LOG_TOP_N         8
+#define SNAKE_REPLAY_MAX_STEPS  1024
+
+// A game is replayed from its rand() seed and the ticks at which the direction
+// changed. Each step is (ticks since previous step) << 2 | direction.
+typedef struct snake_replay
+{
+    uint32_t seed;
+    uint16_t step_count;
+    bool complete;
+    uint16_t steps[SNAKE_REPLAY_MAX_STEPS];
+} snake_replay;
+
+typedef struct score_entry
+{
+    uint32_t seq;
+    uint32_t score;
+    uint8_t level;
+    bool has_replay;
+    uint16_t sector;
+    uint16_t offset;
+    uint16_t len;
+} score_entry;
+
+typedef struct score_log_stats
+{
+    uint32_t records;       // live records in the rebuilt index, relocated copies and garbage not counted
+    uint32_t boot_us;       // time spent rebuilding the index
+    uint32_t user_bytes;    // record bytes appended by score_log_add
+    uint32_t flash_bytes;   // all bytes written, including relocations and sector headers
+    uint32_t erases;
+} score_log_stats;
+
+// Scans the log and rebuilds the in-RAM leaderboard, starts the compaction task.
+esp_err_t score_log_init(void);
+
+// Leaderboard sorted best first, returns the number of entries.
+int score_log_top(const score_entry** entries);
+
+bool score_log_qualifies(uint32_t score);
+esp_err_t score_log_add(uint32_t score, uint8_t level, const snake_replay* replay);
+esp_err_t score_log_load_replay(const score_entry* entry, snake_replay* replay);
+
+// Compaction normally runs on its own task, these are exposed for host tools.
+bool score_log_needs_compaction(void);
+void score_log_compact(void);
+
+const score_log_stats* score_log_get_stats(void);
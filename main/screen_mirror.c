@@ -0,0 +1,148 @@
+#include <stdbool.h>
+#include <string.h>
+#include <driver/uart.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "screen_mirror.h"
+
+#define MIRROR_TILES        128     // 128x64 display in 8x8 tiles
+#define MIRROR_FRAME_SIZE   (MIRROR_TILES * 8)
+#define MIRROR_MASK_SIZE    (MIRROR_TILES / 8)
+#define MIRROR_HEADER_SIZE  6
+#define MIRROR_PACKET_SIZE  (MIRROR_HEADER_SIZE + MIRROR_MASK_SIZE + MIRROR_FRAME_SIZE + \
+    MIRROR_FRAME_SIZE / 128 + 2)
+#define MIRROR_REPORT_EVERY 256
+
+static const char *TAG = "screen_mirror";
+
+static int mirror_uart = -1;
+static uint8_t prev_frame[MIRROR_FRAME_SIZE];
+static uint8_t delta[MIRROR_FRAME_SIZE];
+static uint8_t packet[MIRROR_PACKET_SIZE];
+static uint8_t seq = 0;
+static screen_mirror_stats stats;
+
+void screen_mirror_init(int uart_num, int tx_pin, int baud_rate)
+{
+    uart_config_t config = {
+        .baud_rate = baud_rate,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    //the tx ring buffer holds a few frames so the game loop never waits on the wire
+    if(uart_driver_install(uart_num, 256, 4 * MIRROR_PACKET_SIZE, 0, NULL, 0) != ESP_OK ||
+        uart_param_config(uart_num, &config) != ESP_OK ||
+        uart_set_pin(uart_num, tx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "uart %d setup failed", uart_num);
+        return;
+    }
+    mirror_uart = uart_num;
+}
+
+//PackBits: n < 0x80 is a literal run of n + 1 bytes, n >= 0x80 repeats the next byte n - 0x7F times
+static size_t rle_encode(const uint8_t* in, size_t len, uint8_t* out)
+{
+    size_t i = 0, o = 0;
+    while(i < len)
+    {
+        size_t run = 1;
+        while(i + run < len && run < 128 && in[i + run] == in[i])
+            run++;
+        if(run >= 3)
+        {
+            out[o++] = 0x7F + run;
+            out[o++] = in[i];
+            i += run;
+            continue;
+        }
+
+        //literal until the next run of three or the 128 byte limit
+        size_t start = i;
+        while(i < len && i - start < 128 &&
+            !(i + 2 < len && in[i] == in[i + 1] && in[i] == in[i + 2]))
+            i++;
+        out[o++] = i - start - 1;
+        memcpy(out + o, in + start, i - start);
+        o += i - start;
+    }
+    return o;
+}
+
+static uint16_t fletcher16(const uint8_t* data, size_t len)
+{
+    uint16_t a = 0, b = 0;
+    for(size_t i = 0; i < len; i++)
+    {
+        a = (a + data[i]) % 255;
+        b = (b + a) % 255;
+    }
+    return b << 8 | a;
+}
+
+void screen_mirror_frame(u8g2_t* u8g2)
+{
+    if(mirror_uart < 0)
+        return;
+
+    int64_t start = esp_timer_get_time();
+    const uint8_t* frame = u8g2_GetBufferPtr(u8g2);
+    bool key = (seq % MIRROR_KEY_INTERVAL) == 0;
+    uint8_t* mask = packet + MIRROR_HEADER_SIZE;
+    memset(mask, 0, MIRROR_MASK_SIZE);
+
+    //tiles are 8 consecutive column bytes in the u8g2 full buffer
+    size_t delta_len = 0;
+    for(int tile = 0; tile < MIRROR_TILES; tile++)
+    {
+        //the u8g2 buffer has no alignment guarantee, go through memcpy
+        uint32_t cur[2], prev[2];
+        memcpy(cur, frame + tile * 8, 8);
+        memcpy(prev, prev_frame + tile * 8, 8);
+        uint32_t diff[2] = { cur[0], cur[1] };
+        if(!key)
+        {
+            diff[0] ^= prev[0];
+            diff[1] ^= prev[1];
+            if(!(diff[0] | diff[1]))
+                continue;
+        }
+        mask[tile >> 3] |= 1 << (tile & 7);
+        memcpy(delta + delta_len, diff, 8);
+        memcpy(prev_frame + tile * 8, cur, 8);
+        delta_len += 8;
+    }
+
+    size_t payload_len = 0;
+    if(delta_len)
+        payload_len = MIRROR_MASK_SIZE + rle_encode(delta, delta_len, mask + MIRROR_MASK_SIZE);
+
+    packet[0] = 0xA5;
+    packet[1] = 0x5A;
+    packet[2] = key ? MIRROR_KEY : MIRROR_DELTA;
+    packet[3] = seq++;
+    packet[4] = payload_len & 0xFF;
+    packet[5] = payload_len >> 8;
+    uint16_t check = fletcher16(packet + 2, MIRROR_HEADER_SIZE - 2 + payload_len);
+    packet[MIRROR_HEADER_SIZE + payload_len] = check & 0xFF;
+    packet[MIRROR_HEADER_SIZE + payload_len + 1] = check >> 8;
+    size_t packet_len = MIRROR_HEADER_SIZE + payload_len + 2;
+    stats.encode_us += esp_timer_get_time() - start;
+
+    uart_write_bytes(mirror_uart, packet, packet_len);
+    stats.frames++;
+    stats.bytes += packet_len;
+    if(stats.frames % MIRROR_REPORT_EVERY == 0)
+        ESP_LOGI(TAG, "%d bytes/frame of %d raw, encode %d us/frame",
+            (int)(stats.bytes / stats.frames), MIRROR_FRAME_SIZE,
+            (int)(stats.encode_us / stats.frames));
+}
+
+const screen_mirror_stats* screen_mirror_get_stats(void)
+{
+    return &stats;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <u8g2.h>
+
+// Streams the u8g2 frame buffer over a UART as XOR deltas against the previous
+// frame, decoded by tools/mirror_view.py. Packet layout:
+//   0xA5 0x5A, type, seq, payload length (u16 LE), payload, fletcher16 (u16 LE)
+// type is MIRROR_DELTA or MIRROR_KEY, a key frame is a delta against a blank screen.
+// An empty payload means nothing changed, otherwise it is a 16 byte bitmask of the
+// changed 8x8 tiles followed by the PackBits RLE of their XORed bytes.
+
+#define MIRROR_DELTA        0
+#define MIRROR_KEY          1
+#define MIRROR_KEY_INTERVAL 64
+
+typedef struct screen_mirror_stats
+{
+    uint32_t frames;
+    uint32_t bytes;         // packet bytes sent, headers included
+    uint32_t encode_us;
+} screen_mirror_stats;
+
+// Only the TX pin is used. The console must not share uart_num, ESP_LOG writes
+// straight to the FIFO and would land in the middle of a packet.
+void screen_mirror_init(int uart_num, int tx_pin, int baud_rate);
+
+// Call once per frame, before or after u8g2_SendBuffer.
+void screen_mirror_frame(u8g2_t* u8g2);
+
+const screen_mirror_stats* screen_mirror_get_stats(void);
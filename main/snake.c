@@ -1,5 +1,7 @@
+#include <assert.h>
 #include <driver/gpio.h>
 #include <driver/i2c_master.h>
+#include <driver/spi_master.h>
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -8,30 +10,74 @@
 #include "sdkconfig.h"
 #include "driver/rtc_io.h"
 #include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_random.h"
 
 #include <u8g2.h>
 #include "u8g2_esp32_hal.h"
+#include "level_pack.h"
+#include "score_log.h"
+#include "screen_mirror.h"
+#include "display_spi.h"
+#include "world.h"
 
 #define DISPLAY_WIDTH 128
 #define DISPLAY_HEIGHT 64
-#define MAP_WIDTH 20
-#define MAP_HEIGHT 10
+#define VIEW_WIDTH 20       //cells on screen, bigger worlds scroll
+#define VIEW_HEIGHT 10
+#define VIEW_X_OFFSET ((DISPLAY_WIDTH - 4*VIEW_WIDTH) / 2 - 1)
+#define VIEW_Y_OFFSET 4
+#define SNAKE_MAX_LENGTH 2048    //segments, eating at this length scores but no longer grows
+
+#if SNAKE_MAX_LENGTH < 4
+#error "SNAKE_MAX_LENGTH has to fit the starting snake"
+#endif
+
+#define MINIMAP_X 108           //top left of the minimap frame, right of the playfield
+#define MINIMAP_Y 20
+#define DEFAULT_TICK_MS 50
+#define DEFAULT_APPLE_SCORE 7
 
 #define LEFT_BUTTON  15
 #define DOWN_BUTTON  2
 #define UP_BUTTON    27
 #define RIGHT_BUTTON 26
 
+#define DISPLAY_BUS_I2C 0
+#define DISPLAY_BUS_SPI 1
+#define DISPLAY_BUS DISPLAY_BUS_I2C     //DISPLAY_BUS_SPI for 4-wire SPI panels
+
 #define PIN_SDA 21
 #define PIN_SCL 22
 
+#define PIN_SPI_CLK   18
+#define PIN_SPI_MOSI  23
+#define PIN_SPI_CS    5
+#define PIN_SPI_DC    17
+#define PIN_SPI_RESET 16
+#define SPI_CLOCK_HZ  8000000
+#define DISPLAY_SETUP_SPI u8g2_Setup_sh1106_128x64_noname_f    //u8g2_Setup_ssd1306_128x64_noname_f for SSD1306
+
+#define SCREEN_MIRROR 0         //1 streams every frame over MIRROR_UART, view with tools/mirror_view.py
+#define MIRROR_UART 1           //not the console UART, logs would break up the packets
+#define PIN_MIRROR_TX 25
+#define MIRROR_BAUD 115200
+
+#if SCREEN_MIRROR && defined(CONFIG_ESP_CONSOLE_UART_NUM) && MIRROR_UART == CONFIG_ESP_CONSOLE_UART_NUM
+#error "MIRROR_UART has to be a different UART than the console"
+#endif
 
+
+//cell has to stay first, the spatial index hands back world_entry pointers
 typedef struct snake_node
 {
+    world_entry cell;
     struct snake_node* next;
+    struct snake_node* prev;
     short int x;
     short int y;
     short int next_direction;
+    short int prev_direction;
     bool eaten;
     
 } snake_node;
@@ -43,7 +89,12 @@ typedef enum direction
 
 static u8g2_t u8g2;
 static u8g2_esp32_hal_t u8g2_esp32_hal = U8G2_ESP32_HAL_DEFAULT;
-static bool snake_map[MAP_HEIGHT][MAP_WIDTH];
+static snake_node* snake_tail;
+static snake_node snake_pool[SNAKE_MAX_LENGTH + 1];    //one spare, the new head goes in before the tail leaves
+static snake_node* snake_pool_free;
+static int snake_pool_used, snake_length;
+static world_camera camera;
+static snake_replay replay;
 int snake_highscore = 0;
 
 void init_low_power_mode()
@@ -65,62 +116,156 @@ void init_buttons()
     }
 }
 
-void init_display()
+void snake_send_buffer()
 {
-    u8g2_esp32_hal.bus.i2c.sda = PIN_SDA;
-    u8g2_esp32_hal.bus.i2c.scl = PIN_SCL;
-    u8g2_esp32_hal_init(u8g2_esp32_hal);
+    static uint32_t frames = 0, send_us = 0;
 
+    screen_mirror_frame(&u8g2);
+    int64_t start = esp_timer_get_time();
+    u8g2_SendBuffer(&u8g2);
+    send_us += esp_timer_get_time() - start;
+
+    //on I2C the send is the whole transfer, on SPI it only queues and the wire time is separate
+    if(++frames % 256 == 0)
+    {
+        if(DISPLAY_BUS == DISPLAY_BUS_SPI)
+            ESP_LOGI("snake", "send %d us/frame, spi wire %d us/frame, blocked %d us/frame",
+                (int)(send_us / frames), (int)(display_spi_get_stats()->wire_us / frames),
+                (int)(display_spi_get_stats()->blocked_us / frames));
+        else
+            ESP_LOGI("snake", "send %d us/frame", (int)(send_us / frames));
+    }
+}
+
+//queued display transfers have to finish before the bus clocks stop
+void snake_light_sleep()
+{
+    if(DISPLAY_BUS == DISPLAY_BUS_SPI)
+        display_spi_flush();
+    esp_light_sleep_start();
+}
+
+void init_display()
+{
+    if(DISPLAY_BUS == DISPLAY_BUS_SPI)
+    {
+        display_spi_config config = {
+            .host = SPI2_HOST, .clk = PIN_SPI_CLK, .mosi = PIN_SPI_MOSI, .cs = PIN_SPI_CS,
+            .dc = PIN_SPI_DC, .reset = PIN_SPI_RESET, .clock_hz = SPI_CLOCK_HZ,
+        };
+        display_spi_init(&config);
+        DISPLAY_SETUP_SPI(&u8g2, U8G2_R0, display_spi_byte_cb, display_spi_gpio_and_delay_cb);
+    }
+    else
+    {
+        u8g2_esp32_hal.bus.i2c.sda = PIN_SDA;
+        u8g2_esp32_hal.bus.i2c.scl = PIN_SCL;
+        u8g2_esp32_hal_init(u8g2_esp32_hal);
+
+        u8g2_Setup_sh1106_i2c_128x64_noname_f(&u8g2, U8G2_R0,
+            u8g2_esp32_i2c_byte_cb,
+            u8g2_esp32_gpio_and_delay_cb);
+        u8x8_SetI2CAddress(&u8g2.u8x8, 0x78);
+    }
 
-    u8g2_Setup_sh1106_i2c_128x64_noname_f(&u8g2, U8G2_R0,
-        u8g2_esp32_i2c_byte_cb,
-        u8g2_esp32_gpio_and_delay_cb); 
-    
-    u8x8_SetI2CAddress(&u8g2.u8x8, 0x78);
     u8g2_InitDisplay(&u8g2);  // initialize display, display is in sleep mode after this
     u8g2_SetPowerSave(&u8g2, 0);  // wake up display
     u8g2_ClearBuffer(&u8g2);
-    u8g2_SendBuffer(&u8g2);
+    snake_send_buffer();
 }
 
-snake_node* snake_init()
+//segments come out of a static pool, freed ones are chained through next. It can't run
+//dry, the game loop pops the tail as soon as the snake is past SNAKE_MAX_LENGTH
+snake_node* snake_alloc_segment()
 {
-    snake_node* snake_segment1 = (snake_node*)malloc(sizeof(snake_node));
-    snake_node* snake_segment2 = (snake_node*)malloc(sizeof(snake_node));
-    snake_node* snake_segment3 = (snake_node*)malloc(sizeof(snake_node));
-    snake_node* snake_segment4 = (snake_node*)malloc(sizeof(snake_node));
+    snake_node* node = snake_pool_free;
+    if(node)
+        snake_pool_free = node->next;
+    else
+    {
+        assert(snake_pool_used < SNAKE_MAX_LENGTH + 1);
+        node = &snake_pool[snake_pool_used++];
+    }
+    snake_length++;
+    return node;
+}
+
+void snake_free_segment(snake_node* node)
+{
+    node->next = snake_pool_free;
+    snake_pool_free = node;
+    snake_length--;
+}
+
+//the previous snake was given back with snake_free_memory, so the pool has room for four
+snake_node* snake_init(short int x, short int y)
+{
+    snake_node* snake_segment1 = snake_alloc_segment();
+    snake_node* snake_segment2 = snake_alloc_segment();
+    snake_node* snake_segment3 = snake_alloc_segment();
+    snake_node* snake_segment4 = snake_alloc_segment();
     
-    snake_segment1->x = 12; snake_segment1->y = 5; snake_segment1->eaten = false;
-    snake_segment2->x = 11; snake_segment2->y = 5; snake_segment2->eaten = false;
-    snake_segment3->x = 10; snake_segment3->y = 5; snake_segment3->eaten = false;
-    snake_segment4->x = 9;  snake_segment4->y = 5; snake_segment4->eaten = false;
+    snake_segment1->x = x;                  snake_segment1->y = y; snake_segment1->eaten = false;
+    snake_segment2->x = world_wrap_x(x - 1); snake_segment2->y = y; snake_segment2->eaten = false;
+    snake_segment3->x = world_wrap_x(x - 2); snake_segment3->y = y; snake_segment3->eaten = false;
+    snake_segment4->x = world_wrap_x(x - 3); snake_segment4->y = y; snake_segment4->eaten = false;
 
     snake_segment1->next = snake_segment2; snake_segment1->next_direction = LEFT; 
     snake_segment2->next = snake_segment3; snake_segment2->next_direction = LEFT;
     snake_segment3->next = snake_segment4; snake_segment3->next_direction = LEFT;
     snake_segment4->next = NULL;           snake_segment4->next_direction = LEFT;
 
-    snake_map[5][9] = true;  snake_map[5][10] = true;
-    snake_map[5][11] = true; snake_map[5][12] = true;
+    snake_segment1->prev = NULL;           snake_segment1->prev_direction = LEFT;
+    snake_segment2->prev = snake_segment1; snake_segment2->prev_direction = LEFT;
+    snake_segment3->prev = snake_segment2; snake_segment3->prev_direction = LEFT;
+    snake_segment4->prev = snake_segment3; snake_segment4->prev_direction = LEFT;
+
+    for(snake_node* curr = snake_segment1; curr; curr = curr->next)
+    {
+        world_set(curr->x, curr->y, true);
+        world_index_add(&curr->cell, curr->x, curr->y);
+    }
+    snake_tail = snake_segment4;
 
     return snake_segment1;
 }
 
+//walls are stamped into the world once, so collision and spawn checks see them for free
+void snake_load_level(const snake_level* level)
+{
+    world_reset(level, VIEW_WIDTH, VIEW_HEIGHT);
+    camera.width = world_width() < VIEW_WIDTH ? world_width() : VIEW_WIDTH;
+    camera.height = world_height() < VIEW_HEIGHT ? world_height() : VIEW_HEIGHT;
+    camera.x = 0;
+    camera.y = 0;
+}
+
+//keeps the head in the middle of the screen, worlds that fit on screen never scroll
+void snake_update_camera(snake_node* snake_head)
+{
+    if(world_width() > camera.width)
+        camera.x = world_wrap_x(snake_head->x - camera.width / 2);
+    if(world_height() > camera.height)
+        camera.y = world_wrap_y(snake_head->y - camera.height / 2);
+}
+
 void snake_free_memory(snake_node* snake_head)
 {
     snake_node* prev = snake_head;
     while(snake_head)
     {
         snake_head = snake_head->next;
-        free(prev);
+        snake_free_segment(prev);
         prev = snake_head;
     }
 }
 
 snake_node* snake_add_segment(snake_node* snake_head, direction snake_direction)
 {
-    snake_node* new_head = (snake_node*)malloc(sizeof(snake_node));
+    snake_node* new_head = snake_alloc_segment();
     new_head->next = snake_head;
+    new_head->prev = NULL;
+    snake_head->prev = new_head;
     new_head->x = snake_head->x;
     new_head->y = snake_head->y;
     new_head->eaten = false;
@@ -131,45 +276,44 @@ snake_node* snake_add_segment(snake_node* snake_head, direction snake_direction)
     case LEFT:
         snake_head->x--;
         if(snake_head->x < 0)
-            snake_head->x = MAP_WIDTH - 1;
+            snake_head->x = world_width() - 1;
         snake_head->next_direction = RIGHT;
         break;
     case DOWN:
         snake_head->y--;
         if(snake_head->y < 0)
-            snake_head->y = MAP_HEIGHT - 1;
+            snake_head->y = world_height() - 1;
         snake_head->next_direction = UP;
         break;
     case UP:
         snake_head->y++;
-        if(snake_head->y >= MAP_HEIGHT)
+        if(snake_head->y >= world_height())
             snake_head->y = 0;
         snake_head->next_direction = DOWN;
         break;
     case RIGHT:
         snake_head->x++;
-        if(snake_head->x >= MAP_WIDTH)
+        if(snake_head->x >= world_width())
             snake_head->x = 0;
         snake_head->next_direction = LEFT;
         break;
     }
-    snake_map[snake_head->y][snake_head->x] = true;
+    snake_head->next->prev_direction = snake_head->next_direction;
+    world_set(snake_head->x, snake_head->y, true);
+    world_index_add(&snake_head->cell, snake_head->x, snake_head->y);
     
     return snake_head;
 }
 
+//the tail is tracked so a long snake does not have to be walked every tick
 void snake_pop_last_segment(snake_node* snake_head)
 {
-    snake_node* curr = snake_head;
-    snake_node* prev = snake_head;
-    while(curr->next)
-    {
-        prev = curr;
-        curr = curr->next;
-    }
-    snake_map[curr->y][curr->x] = false;
-    free(curr);
-    prev->next = NULL;
+    snake_node* curr = snake_tail;
+    snake_tail = curr->prev;
+    snake_tail->next = NULL;
+    world_set(curr->x, curr->y, false);
+    world_index_remove(&curr->cell);
+    snake_free_segment(curr);
 }
 
 bool snake_apple_in_front(snake_node* snake_head, direction snake_direction, short int apple_x, short int apple_y)
@@ -178,29 +322,29 @@ bool snake_apple_in_front(snake_node* snake_head, direction snake_direction, sho
     {
         case LEFT:
             if(snake_head->y == apple_y &&
-                (((snake_head->x - 1 + MAP_WIDTH) % MAP_WIDTH) == apple_x ||
-                ((snake_head->x - 2 + MAP_WIDTH) % MAP_WIDTH) == apple_x))
+                (world_wrap_x(snake_head->x - 1) == apple_x ||
+                world_wrap_x(snake_head->x - 2) == apple_x))
                 return true;
             else
                 return false;
         case RIGHT:
             if(snake_head->y == apple_y &&
-                (((snake_head->x+1) % MAP_WIDTH) == apple_x ||
-                ((snake_head->x+2) % MAP_WIDTH) == apple_x))
+                (world_wrap_x(snake_head->x + 1) == apple_x ||
+                world_wrap_x(snake_head->x + 2) == apple_x))
                 return true;
             else
                 return false;
         case DOWN:
             if(snake_head->x == apple_x &&
-                (((snake_head->y - 1 + MAP_HEIGHT) % MAP_HEIGHT) == apple_y ||
-                ((snake_head->y - 2 + MAP_HEIGHT) % MAP_HEIGHT) == apple_y))
+                (world_wrap_y(snake_head->y - 1) == apple_y ||
+                world_wrap_y(snake_head->y - 2) == apple_y))
                 return true;
             else
                 return false;
         case UP:
             if(snake_head->x == apple_x &&
-                (((snake_head->y+1) % MAP_HEIGHT) == apple_y ||
-                ((snake_head->y+2) % MAP_HEIGHT) == apple_y))
+                (world_wrap_y(snake_head->y + 1) == apple_y ||
+                world_wrap_y(snake_head->y + 2) == apple_y))
                 return true;
             else
                 return false;
@@ -209,179 +353,175 @@ bool snake_apple_in_front(snake_node* snake_head, direction snake_direction, sho
     }
 }
 
-void snake_draw_snake(snake_node* snake_head, direction snake_direction)
+//world pixels are 4 per cell and wrap around the world, anything off camera is dropped
+void snake_draw_world_pixel(int x, int y)
 {
-    short int x_offset = (DISPLAY_WIDTH - 4*MAP_WIDTH) / 2 - 1;
-    short int y_offset = 4;
-    short int x_pos, y_pos; 
+    x = (x - 4 * camera.x) % (4 * world_width());
+    y = (y - 4 * camera.y) % (4 * world_height());
+    if(x < 0)
+        x += 4 * world_width();
+    if(y < 0)
+        y += 4 * world_height();
+    if(x < 4 * camera.width && y < 4 * camera.height)
+        u8g2_DrawPixel(&u8g2, VIEW_X_OFFSET + x, DISPLAY_HEIGHT - (VIEW_Y_OFFSET + y));
+}
 
-    //draw the middle part
-    snake_node* curr = snake_head->next;
-    direction prev_direction = snake_head->next_direction;
-    while(curr->next)
+void snake_draw_segment(snake_node* curr)
+{
+    short int x_pos = curr->x * 4;
+    short int y_pos = curr->y * 4;
+    direction prev_direction = curr->prev_direction;
+
+    bool orientation = true;
+    if(prev_direction == DOWN || prev_direction == RIGHT)
+        orientation = false;
+    if(curr->next_direction != prev_direction && 
+        (curr->next_direction == DOWN || curr->next_direction == RIGHT))
+        orientation = !orientation;
+    if(orientation)
     {
-        x_pos = curr->x * 4;
-        y_pos = curr->y * 4;
-
-        bool orientation = true;
-        if(prev_direction == DOWN || prev_direction == RIGHT)
-            orientation = false;
-        if(curr->next_direction != prev_direction && 
-            (curr->next_direction == DOWN || curr->next_direction == RIGHT))
-            orientation = !orientation;
-        if(orientation)
-        {
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 1, DISPLAY_HEIGHT - (y_offset + y_pos + 2));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-        }
-        else
-        {
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 1, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 2));
-        }
+        snake_draw_world_pixel(x_pos + 1, y_pos + 2);
+        snake_draw_world_pixel(x_pos + 2, y_pos + 1);
+    }
+    else
+    {
+        snake_draw_world_pixel(x_pos + 1, y_pos + 1);
+        snake_draw_world_pixel(x_pos + 2, y_pos + 2);
+    }
 
-        if(curr->eaten)
-        {
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 0, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 0, DISPLAY_HEIGHT - (y_offset + y_pos + 2));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 3, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 3, DISPLAY_HEIGHT - (y_offset + y_pos + 2));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 1, DISPLAY_HEIGHT - (y_offset + y_pos + 0));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 0));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 1, DISPLAY_HEIGHT - (y_offset + y_pos + 3));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 3));
-        }
+    if(curr->eaten)
+    {
+        snake_draw_world_pixel(x_pos + 0, y_pos + 1);
+        snake_draw_world_pixel(x_pos + 0, y_pos + 2);
+        snake_draw_world_pixel(x_pos + 3, y_pos + 1);
+        snake_draw_world_pixel(x_pos + 3, y_pos + 2);
+        snake_draw_world_pixel(x_pos + 1, y_pos + 0);
+        snake_draw_world_pixel(x_pos + 2, y_pos + 0);
+        snake_draw_world_pixel(x_pos + 1, y_pos + 3);
+        snake_draw_world_pixel(x_pos + 2, y_pos + 3);
+    }
 
-        switch(curr->next_direction)
-        {
-            case LEFT:
-                x_pos -= 2; break;
-            case RIGHT:
-                x_pos += 2; break;
-            case DOWN:
-                y_pos -= 2; break;
-            case UP:
-                y_pos += 2; break;
-        }
-        u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 1 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-            DISPLAY_HEIGHT - (y_offset + (y_pos + 1 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-        u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 2 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-            DISPLAY_HEIGHT - (y_offset + (y_pos + 1 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-        u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 1 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-            DISPLAY_HEIGHT - (y_offset + (y_pos + 2 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-        u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 2 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-            DISPLAY_HEIGHT - (y_offset + (y_pos + 2 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-
-        prev_direction = curr->next_direction;
-        curr = curr->next;
+    switch(curr->next_direction)
+    {
+        case LEFT:
+            x_pos -= 2; break;
+        case RIGHT:
+            x_pos += 2; break;
+        case DOWN:
+            y_pos -= 2; break;
+        case UP:
+            y_pos += 2; break;
     }
+    snake_draw_world_pixel(x_pos + 1, y_pos + 1);
+    snake_draw_world_pixel(x_pos + 2, y_pos + 1);
+    snake_draw_world_pixel(x_pos + 1, y_pos + 2);
+    snake_draw_world_pixel(x_pos + 2, y_pos + 2);
+}
 
-    //draw the tail
-    x_pos = 4 * curr->x;
-    y_pos = 4 * curr->y;
-    switch(prev_direction)
+void snake_draw_tail(snake_node* curr)
+{
+    short int x_pos = 4 * curr->x;
+    short int y_pos = 4 * curr->y;
+    switch(curr->prev_direction)
     {
         case RIGHT:
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 1, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 1, DISPLAY_HEIGHT - (y_offset + y_pos + 2));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 3, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
+            snake_draw_world_pixel(x_pos + 1, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 1, y_pos + 2);
+            snake_draw_world_pixel(x_pos + 3, y_pos + 1);
             break;
         case LEFT:
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 1, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 2));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 0, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
+            snake_draw_world_pixel(x_pos + 1, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 2);
+            snake_draw_world_pixel(x_pos + 0, y_pos + 1);
             break;
         case UP:
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 1, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 2));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 3));
+            snake_draw_world_pixel(x_pos + 1, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 2);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 3);
             break;
         case DOWN:
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 1, DISPLAY_HEIGHT - (y_offset + y_pos + 2));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 2));
-            u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 0));
+            snake_draw_world_pixel(x_pos + 1, y_pos + 2);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 2);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 0);
             break;
     }
+}
+
+void snake_draw_visible_segment(world_entry* entry, int view_x, int view_y, void* snake_head)
+{
+    snake_node* curr = (snake_node*)entry;
+    if(curr == snake_head)
+        return;
+    if(curr->next)
+        snake_draw_segment(curr);
+    else
+        snake_draw_tail(curr);
+}
+
+//only the segments near the screen are visited, the cost does not grow with the snake
+void snake_draw_snake(snake_node* snake_head, direction snake_direction)
+{
+    world_for_each_visible(&camera, 1, snake_draw_visible_segment, snake_head);
 
     //draw head
-    x_pos = snake_head->x * 4;
-    y_pos = snake_head->y * 4;
-    u8g2_DrawPixel(&u8g2, x_offset + x_pos + 1, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-    u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 1));
-    u8g2_DrawPixel(&u8g2, x_offset + x_pos + 1, DISPLAY_HEIGHT - (y_offset + y_pos + 2));
-    u8g2_DrawPixel(&u8g2, x_offset + x_pos + 2, DISPLAY_HEIGHT - (y_offset + y_pos + 2));
+    short int x_pos = snake_head->x * 4;
+    short int y_pos = snake_head->y * 4;
+    snake_draw_world_pixel(x_pos + 1, y_pos + 1);
+    snake_draw_world_pixel(x_pos + 2, y_pos + 1);
+    snake_draw_world_pixel(x_pos + 1, y_pos + 2);
+    snake_draw_world_pixel(x_pos + 2, y_pos + 2);
 
     //draw neck and eye
     switch(snake_head->next_direction)
     {
         case RIGHT:
             x_pos += 2;
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 1 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 1 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 2 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 1 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 1 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 3 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 2 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 2 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
+            snake_draw_world_pixel(x_pos + 1, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 1, y_pos + 3);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 2);
             u8g2_SetDrawColor(&u8g2, 0);
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 1 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 2 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
+            snake_draw_world_pixel(x_pos + 1, y_pos + 2);
             u8g2_SetDrawColor(&u8g2, 1);
             break;
         case LEFT:
             x_pos -= 2;
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 1 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 1 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 2 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 1 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 1 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 2 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 2 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 3 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
+            snake_draw_world_pixel(x_pos + 1, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 1, y_pos + 2);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 3);
             u8g2_SetDrawColor(&u8g2, 0);
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 2 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 2 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
+            snake_draw_world_pixel(x_pos + 2, y_pos + 2);
             u8g2_SetDrawColor(&u8g2, 1);
             break;
         case DOWN:
             y_pos -= 2;
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 1 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 1 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 2 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 1 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 0 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 2 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 2 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 2 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
+            snake_draw_world_pixel(x_pos + 1, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 0, y_pos + 2);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 2);
             u8g2_SetDrawColor(&u8g2, 0);
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 1 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 2 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
+            snake_draw_world_pixel(x_pos + 1, y_pos + 2);
             u8g2_SetDrawColor(&u8g2, 1);
             break;
         case UP:
             y_pos += 2;
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 0 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 1 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 2 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 1 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 1 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 2 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 2 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 2 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
+            snake_draw_world_pixel(x_pos + 0, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 1);
+            snake_draw_world_pixel(x_pos + 1, y_pos + 2);
+            snake_draw_world_pixel(x_pos + 2, y_pos + 2);
             u8g2_SetDrawColor(&u8g2, 0);
-            u8g2_DrawPixel(&u8g2, x_offset + (x_pos + 1 + 4 * MAP_WIDTH)  % (4 * MAP_WIDTH),
-                DISPLAY_HEIGHT - (y_offset + (y_pos + 1 + 4 * MAP_HEIGHT) % (4 * MAP_HEIGHT)));
+            snake_draw_world_pixel(x_pos + 1, y_pos + 1);
             u8g2_SetDrawColor(&u8g2, 1);
             break;
     }
 }
 
-void snake_start_screen()
+void snake_start_screen(const snake_level* level, bool replay_available)
 {
     u8g2_ClearBuffer(&u8g2);
 
@@ -393,11 +533,25 @@ void snake_start_screen()
 
     u8g2_SetFont(&u8g2, u8g2_font_5x7_tr);
     const char *prompt = "Press any button to play";
+    char prompt_buf[32];
+    if(level || replay_available)
+    {
+        snprintf(prompt_buf, sizeof(prompt_buf), "%s%s*:play",
+            level ? "R:level " : "", replay_available ? "U:replay " : "");
+        prompt = prompt_buf;
+    }
+    if(level)
+    {
+        char name[LEVEL_NAME_LEN + 1];
+        snprintf(name, sizeof(name), "%.*s", LEVEL_NAME_LEN, level->name);
+        short int name_x = (DISPLAY_WIDTH - u8g2_GetStrWidth(&u8g2, name)) / 2;
+        u8g2_DrawStr(&u8g2, name_x, 51, name);
+    }
     short int prompt_width = u8g2_GetStrWidth(&u8g2, prompt);
     short int prompt_x = (DISPLAY_WIDTH - prompt_width) / 2;
     u8g2_DrawStr(&u8g2, prompt_x, 60, prompt);
 
-    u8g2_SendBuffer(&u8g2);
+    snake_send_buffer();
 }
 
 void snake_end_screen(int score)
@@ -425,7 +579,7 @@ void snake_end_screen(int score)
     u8g2_DrawStr(&u8g2, 5, 60, "Play Again");
     u8g2_DrawStr(&u8g2, 95, 60, "Exit");
 
-    u8g2_SendBuffer(&u8g2);
+    snake_send_buffer();
 
     if (score > snake_highscore)
         snake_highscore = score;
@@ -447,15 +601,15 @@ bool snake_collision_check(snake_node* snake_head, direction snake_direction)
             head_y--; break;
     }
 
-    return snake_map[head_y % MAP_HEIGHT][head_x % MAP_WIDTH];
+    return world_occupied(head_x, head_y);
 }
 
 void snake_draw_frame()
 {
-    short int x1 = (DISPLAY_WIDTH - 4*MAP_WIDTH - 4) / 2 - 1;
-    short int x2 = x1 + 3 + 4 * MAP_WIDTH;
+    short int x1 = (DISPLAY_WIDTH - 4*VIEW_WIDTH - 4) / 2 - 1;
+    short int x2 = x1 + 3 + 4 * VIEW_WIDTH;
     short int y1 = 2;
-    short int y2 = y1 + 3 + 4 * MAP_HEIGHT;
+    short int y2 = y1 + 3 + 4 * VIEW_HEIGHT;
     u8g2_DrawLine(&u8g2, x1, DISPLAY_HEIGHT - y1 ,x1, DISPLAY_HEIGHT - y2);
     u8g2_DrawLine(&u8g2, x2, DISPLAY_HEIGHT - y1 ,x2, DISPLAY_HEIGHT - y2);
     u8g2_DrawLine(&u8g2, x1, DISPLAY_HEIGHT - y1 ,x2, DISPLAY_HEIGHT - y1);
@@ -463,6 +617,54 @@ void snake_draw_frame()
     u8g2_DrawLine(&u8g2, x1, DISPLAY_HEIGHT - (y2 + 2) ,x2, DISPLAY_HEIGHT - (y2 + 2));
 }
 
+void snake_draw_walls(const snake_level* level)
+{
+    if(!level)
+        return;
+
+    for(short int y = 0; y < camera.height; y++)
+        for(short int x = 0; x < camera.width; x++)
+            if(level_is_wall(level, world_wrap_x(camera.x + x), world_wrap_y(camera.y + y)))
+            {
+                u8g2_DrawFrame(&u8g2, VIEW_X_OFFSET + 4 * x, DISPLAY_HEIGHT - (VIEW_Y_OFFSET + 4 * y + 3), 4, 4);
+                u8g2_DrawPixel(&u8g2, VIEW_X_OFFSET + 4 * x + 1, DISPLAY_HEIGHT - (VIEW_Y_OFFSET + 4 * y + 1));
+            }
+}
+
+void snake_draw_minimap_mark(int x, int y, int block, int height, int color)
+{
+    u8g2_SetDrawColor(&u8g2, color);
+    u8g2_DrawPixel(&u8g2, MINIMAP_X + 1 + x / block, MINIMAP_Y + height - y / block);
+    u8g2_SetDrawColor(&u8g2, 1);
+}
+
+//one pixel per block of cells, lit when anything is in it, the blocks of the head and
+//of the apple and animal blink, the food the other way round to the head
+void snake_draw_minimap(snake_node* snake_head, short int apple_x, short int apple_y,
+    short int animal_x, short int animal_y, int tick)
+{
+    if(world_width() <= camera.width && world_height() <= camera.height)
+        return;
+
+    int width, height;
+    int block = world_minimap_size(&width, &height);
+    u8g2_DrawFrame(&u8g2, MINIMAP_X, MINIMAP_Y, width + 2, height + 2);
+    for(short int y = 0; y < height; y++)
+        for(short int x = 0; x < width; x++)
+            if(world_minimap_pixel(x, y))
+                u8g2_DrawPixel(&u8g2, MINIMAP_X + 1 + x, MINIMAP_Y + height - y);
+
+    int blink = (tick >> 2) & 1;
+    snake_draw_minimap_mark(snake_head->x, snake_head->y, block, height, blink);
+    if(apple_x != -1 && apple_y != -1)
+        snake_draw_minimap_mark(apple_x, apple_y, block, height, !blink);
+    if(animal_x != -1 && animal_y != -1)
+    {
+        snake_draw_minimap_mark(animal_x, animal_y, block, height, !blink);
+        snake_draw_minimap_mark(animal_x + 1, animal_y, block, height, !blink);
+    }
+}
+
 void snake_draw_score(int score)
 {
     char score_str[12] = "Score:0000";
@@ -474,10 +676,16 @@ void snake_draw_score(int score)
     u8g2_DrawStr(&u8g2, 21, DISPLAY_HEIGHT - 48, score_str);
 }
 
+//animals span two cells, ones half on screen are clipped to the inside of the frame
 void snake_draw_animal(int x_map, int y_map, int animal_id)
 {
-    int x = (DISPLAY_WIDTH - 4*MAP_WIDTH) / 2 + x_map * 4;
-    int y = 6 + y_map * 4; 
+    int view_x, view_y;
+    if(!world_on_camera(&camera, x_map, y_map, 1, &view_x, &view_y))
+        return;
+    int x = VIEW_X_OFFSET + 1 + view_x * 4;
+    int y = 6 + view_y * 4; 
+    u8g2_SetClipWindow(&u8g2, VIEW_X_OFFSET - 1, DISPLAY_HEIGHT - (VIEW_Y_OFFSET + 4*VIEW_HEIGHT),
+        VIEW_X_OFFSET + 4*VIEW_WIDTH + 1, DISPLAY_HEIGHT - 2);
     switch(animal_id)
     {
         case 0: //lizard
@@ -512,6 +720,7 @@ void snake_draw_animal(int x_map, int y_map, int animal_id)
             u8g2_DrawPixel(&u8g2, x + 6, DISPLAY_HEIGHT - y);
             break;
     }
+    u8g2_SetMaxClipWindow(&u8g2);
 }
 
 void snake_draw_animal_timer(int animal_timer)
@@ -526,12 +735,13 @@ void snake_draw_animal_timer(int animal_timer)
 
 void snake_generate_apple(short int *apple_x, short int *apple_y)
 {
-    short int apple_pos = rand() % (MAP_HEIGHT * MAP_WIDTH);
-    for(short int i = 0; i < MAP_HEIGHT * MAP_WIDTH; i++)
+    int cells = world_width() * world_height();
+    int apple_pos = rand() % cells;
+    for(int i = 0; i < cells; i++)
     {
-        short int x = (apple_pos + i) % MAP_WIDTH;
-        short int y = ((apple_pos + i)  / MAP_WIDTH) % MAP_HEIGHT;
-        if(!snake_map[y][x])
+        short int x = (apple_pos + i) % world_width();
+        short int y = ((apple_pos + i)  / world_width()) % world_height();
+        if(!world_occupied(x, y))
         {
             *apple_x = x;
             *apple_y = y;
@@ -544,12 +754,13 @@ void snake_generate_apple(short int *apple_x, short int *apple_y)
 
 void snake_generate_animal(short int *animal_x, short int *animal_y)
 {
-    short int animal_pos = rand() % (MAP_HEIGHT * MAP_WIDTH);
-    for(short int i = 0; i < MAP_HEIGHT * MAP_WIDTH; i++)
+    int cells = world_width() * world_height();
+    int animal_pos = rand() % cells;
+    for(int i = 0; i < cells; i++)
     {
-        short int x = (animal_pos + i) % MAP_WIDTH;
-        short int y = ((animal_pos + i)  / MAP_WIDTH) % MAP_HEIGHT;
-        if(x != (MAP_WIDTH - 1) && !snake_map[y][x] && !snake_map[y][x+1])
+        short int x = (animal_pos + i) % world_width();
+        short int y = ((animal_pos + i)  / world_width()) % world_height();
+        if(x != (world_width() - 1) && !world_occupied(x, y) && !world_occupied(x + 1, y))
         {
             *animal_x = x;
             *animal_y = y;
@@ -562,11 +773,12 @@ void snake_generate_animal(short int *animal_x, short int *animal_y)
 
 void snake_draw_apple(short int x_map, short int y_map)
 {
-    if(x_map == -1 || y_map == -1)
+    int view_x, view_y;
+    if(x_map == -1 || y_map == -1 || !world_on_camera(&camera, x_map, y_map, 0, &view_x, &view_y))
         return;
 
-    short int x = (DISPLAY_WIDTH - 4*MAP_WIDTH) / 2 + x_map * 4;
-    short int y =  6 + y_map * 4;
+    short int x = VIEW_X_OFFSET + 1 + view_x * 4;
+    short int y =  6 + view_y * 4;
     u8g2_DrawPixel(&u8g2, x - 1, DISPLAY_HEIGHT - y);
     u8g2_DrawPixel(&u8g2, x + 1, DISPLAY_HEIGHT - y);
     u8g2_DrawPixel(&u8g2, x, DISPLAY_HEIGHT - (y - 1));
@@ -575,8 +787,11 @@ void snake_draw_apple(short int x_map, short int y_map)
 
 void snake_open_mouth(snake_node* snake_head, direction snake_direction)
 {
-    short int x = (DISPLAY_WIDTH - 4*MAP_WIDTH) / 2 + snake_head->x * 4;
-    short int y = 5 + snake_head->y * 4;
+    int view_x, view_y;
+    if(!world_on_camera(&camera, snake_head->x, snake_head->y, 0, &view_x, &view_y))
+        return;
+    short int x = VIEW_X_OFFSET + 1 + view_x * 4;
+    short int y = 5 + view_y * 4;
     switch(snake_direction)
     {
         case LEFT:
@@ -614,79 +829,178 @@ void snake_open_mouth(snake_node* snake_head, direction snake_direction)
     }
 }
 
-void snake_death_scene(snake_node* snake_head, direction snake_direction, int score)
+void snake_death_scene(snake_node* snake_head, direction snake_direction, int score,
+    const snake_level* level)
 {
     for(int i = 0; i < 9; i++)
     {
         u8g2_ClearBuffer(&u8g2);
         snake_draw_frame();
+        snake_draw_walls(level);
         snake_draw_score(score);
         if(i % 2)
             snake_draw_snake(snake_head, snake_direction);
-        u8g2_SendBuffer(&u8g2);
+        snake_send_buffer();
         vTaskDelay(100 / portTICK_PERIOD_MS);
     }
 }
 
+//steps hold the ticks since the previous step, long straight runs are split with no-op steps
+void snake_replay_record(snake_replay* replay, int* last_tick, int tick, direction snake_direction)
+{
+    while(replay->complete)
+    {
+        if(replay->step_count == SNAKE_REPLAY_MAX_STEPS)
+        {
+            replay->complete = false;
+            return;
+        }
+        int delta = tick - *last_tick;
+        if(delta <= 0x3FFF)
+        {
+            replay->steps[replay->step_count++] = delta << 2 | snake_direction;
+            *last_tick = tick;
+            return;
+        }
+        direction prev = replay->step_count ? replay->steps[replay->step_count - 1] & 3 : RIGHT;
+        replay->steps[replay->step_count++] = 0x3FFF << 2 | prev;
+        *last_tick += 0x3FFF;
+    }
+}
+
+direction snake_replay_direction(const snake_replay* replay, int* step, int* step_tick, int tick,
+    direction snake_direction)
+{
+    while(*step < replay->step_count && *step_tick + (replay->steps[*step] >> 2) == tick)
+    {
+        *step_tick = tick;
+        snake_direction = replay->steps[(*step)++] & 3;
+    }
+    return snake_direction;
+}
+
 void app_main()
 {
+    if(SCREEN_MIRROR)
+        screen_mirror_init(MIRROR_UART, PIN_MIRROR_TX, MIRROR_BAUD);
     init_display();
     init_buttons();
     init_low_power_mode();
 
+    int level_count = level_pack_open();
+    int level_index = 0;
+    const snake_level* level = level_pack_get(level_index);
+
+    score_log_init();
+    const score_entry* leaderboard;
+    int leaderboard_count = score_log_top(&leaderboard);
+    if(leaderboard_count)
+        snake_highscore = leaderboard[0].score;
+    bool playback;
+    int tick, replay_step, replay_tick;
+
     direction snake_direction;
     snake_node* snake_head = NULL;
-    int score;
+    int score, tick_ms, apple_score;
     short int apple_x, apple_y, apples_till_animal,
         animal_timer, animal_id, animal_x, animal_y;
         
     while(true)
     {
+        //pick a level, right button cycles through the pack, up replays the best game
+        playback = false;
+        while(true)
+        {
+            leaderboard_count = score_log_top(&leaderboard);
+            snake_start_screen(level, leaderboard_count && leaderboard[0].has_replay);
+            snake_light_sleep();
+            uint64_t wakeup = esp_sleep_get_ext1_wakeup_status();
+            if((wakeup & (1ULL << UP_BUTTON)) && leaderboard_count &&
+                score_log_load_replay(&leaderboard[0], &replay) == ESP_OK)
+            {
+                playback = true;
+                level_index = leaderboard[0].level;
+                level = level_pack_get(level_index);
+                break;
+            }
+            if(level_count < 2 || !(wakeup & (1ULL << RIGHT_BUTTON)))
+                break;
+
+            int64_t switch_start = esp_timer_get_time();
+            level_index = (level_index + 1) % level_count;
+            level = level_pack_get(level_index);
+            snake_load_level(level);
+            ESP_LOGD("snake", "level switch took %d us", (int)(esp_timer_get_time() - switch_start));
+
+            while(gpio_get_level(RIGHT_BUTTON))
+                vTaskDelay(10 / portTICK_PERIOD_MS);
+        }
+
         //initialize variables
         snake_direction = RIGHT;
-        snake_head = snake_init();
-        memset(snake_map, 0, sizeof(snake_map));
+        snake_load_level(level);
+        if(level)
+            snake_head = snake_init(level->spawn_x, level->spawn_y);
+        else
+            snake_head = snake_init(12, 5);
+        snake_update_camera(snake_head);
+        tick_ms = (level && level->tick_ms) ? level->tick_ms : DEFAULT_TICK_MS;
+        apple_score = (level && level->apple_score) ? level->apple_score : DEFAULT_APPLE_SCORE;
         apple_x = -1; apple_y = -1, animal_x = -1, animal_y = -1;
         apples_till_animal = 4, animal_timer = 0, score = 0;
+        tick = 0, replay_step = 0, replay_tick = 0;
+        if(!playback)
+        {
+            replay.seed = esp_random();
+            replay.step_count = 0;
+            replay.complete = true;
+        }
+        srand(replay.seed);
         animal_id = rand() % 3;
-        snake_start_screen();
-
-        //check for any button press to start
-        esp_light_sleep_start();
     
         //play loop
         while(true)
         {
             u8g2_ClearBuffer(&u8g2);
 
-            if(gpio_get_level(LEFT_BUTTON) && snake_direction != RIGHT)
-                snake_direction = LEFT;
-            if(gpio_get_level(DOWN_BUTTON) && snake_direction != UP)
-                snake_direction = DOWN;
-            if(gpio_get_level(RIGHT_BUTTON) && snake_direction != LEFT)
-                snake_direction = RIGHT;
-            if(gpio_get_level(UP_BUTTON) && snake_direction != DOWN)
-                snake_direction = UP;
+            if(playback)
+                snake_direction = snake_replay_direction(&replay, &replay_step, &replay_tick, tick,
+                    snake_direction);
+            else
+            {
+                direction prev_direction = snake_direction;
+                if(gpio_get_level(LEFT_BUTTON) && snake_direction != RIGHT)
+                    snake_direction = LEFT;
+                if(gpio_get_level(DOWN_BUTTON) && snake_direction != UP)
+                    snake_direction = DOWN;
+                if(gpio_get_level(RIGHT_BUTTON) && snake_direction != LEFT)
+                    snake_direction = RIGHT;
+                if(gpio_get_level(UP_BUTTON) && snake_direction != DOWN)
+                    snake_direction = UP;
+                if(snake_direction != prev_direction)
+                    snake_replay_record(&replay, &replay_tick, tick, snake_direction);
+            }
 
             if(snake_collision_check(snake_head, snake_direction))
             {
-                snake_death_scene(snake_head, snake_direction, score);
+                snake_death_scene(snake_head, snake_direction, score, level);
                 break;
             }
 
             snake_head = snake_add_segment(snake_head, snake_direction);
 
-            //check if apple is eaten
+            //check if apple is eaten, at SNAKE_MAX_LENGTH the snake stops growing
             if(snake_head->x == apple_x && snake_head->y == apple_y)
             {
-                score += 7;
+                score += apple_score;
                 apple_x = -1;
                 apple_y = -1;
                 snake_head->eaten = true;
                 apples_till_animal--;
             }
-            else
+            if(!snake_head->eaten || snake_length > SNAKE_MAX_LENGTH)
                 snake_pop_last_segment(snake_head);
+            snake_update_camera(snake_head);
 
             //generate new apple if previous one got eaten
             if(apple_x == -1 || apple_y == -1)
@@ -712,9 +1026,9 @@ void app_main()
                 animal_id = rand() % 3;
                 if(apple_x != -1 && apple_y != -1)
                 {
-                    snake_map[apple_y][apple_x] = true;
+                    world_set(apple_x, apple_y, true);
                     snake_generate_animal(&animal_x, &animal_y);
-                    snake_map[apple_y][apple_x] = false;
+                    world_set(apple_x, apple_y, false);
                 }
                 else
                     snake_generate_animal(&animal_x, &animal_y);
@@ -725,7 +1039,10 @@ void app_main()
             if(snake_apple_in_front(snake_head, snake_direction, apple_x, apple_y))
                 snake_open_mouth(snake_head, snake_direction);
             snake_draw_frame();
+            snake_draw_walls(level);
             snake_draw_score(score);
+            snake_draw_minimap(snake_head, apple_x, apple_y,
+                animal_timer > 0 ? animal_x : -1, animal_y, tick);
             snake_draw_apple(apple_x, apple_y);
             if(animal_x != -1 && animal_y != -1 && animal_timer > 0)
             {
@@ -733,15 +1050,18 @@ void app_main()
                 snake_draw_animal(animal_x, animal_y, animal_id);
             }
 
-            u8g2_SendBuffer(&u8g2);
-            vTaskDelay(50 / portTICK_PERIOD_MS);
+            snake_send_buffer();
+            vTaskDelay(tick_ms / portTICK_PERIOD_MS);
+            tick++;
         }
 
+        if(!playback && score_log_qualifies(score))
+            score_log_add(score, level_index, &replay);
         snake_end_screen(score);
         snake_free_memory(snake_head);
 
         //wait for play again or exit button press
-        esp_light_sleep_start();
+        snake_light_sleep();
         /*
         if(!gpio_get_level(LEFT_BUTTON))
             continue; //play again
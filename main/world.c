@@ -0,0 +1,180 @@
+#include <string.h>
+
+#include "world.h"
+
+#define VIEW_MAX_CHUNKS 16
+
+static uint16_t bits[WORLD_MAX_CHUNKS][WORLD_CHUNK];
+static world_entry* buckets[WORLD_MAX_CHUNKS];
+static uint16_t minimap[WORLD_MINIMAP_SIZE][WORLD_MINIMAP_SIZE];
+static int width = 0, height = 0, chunks_x = 0, block = 1;
+
+static inline int chunk_of(int x, int y)
+{
+    return (y >> WORLD_CHUNK_SHIFT) * chunks_x + (x >> WORLD_CHUNK_SHIFT);
+}
+
+//16 wall bits of one row starting at bit, the bitmap is not padded per row
+static uint16_t wall_bits(const snake_level* level, int bit, int count)
+{
+    int byte = bit >> 3, end = (level->width * level->height + 7) / 8;
+    uint32_t v = 0;
+    for(int i = 0; i < 3 && byte + i < end; i++)
+        v |= (uint32_t)level->walls[byte + i] << (8 * i);
+    return (v >> (bit & 7)) & ((1u << count) - 1);
+}
+
+void world_reset(const snake_level* level, int w, int h)
+{
+    width = level ? level->width : w;
+    height = level ? level->height : h;
+    chunks_x = (width + WORLD_CHUNK - 1) >> WORLD_CHUNK_SHIFT;
+    int longer = width > height ? width : height;
+    block = (longer + WORLD_MINIMAP_SIZE - 1) / WORLD_MINIMAP_SIZE;
+    memset(bits, 0, sizeof(bits));
+    memset(buckets, 0, sizeof(buckets));
+    memset(minimap, 0, sizeof(minimap));
+    if(!level)
+        return;
+
+    //a row of a chunk at a time, then count only the wall cells for the minimap
+    for(int y = 0; y < height; y++)
+        for(int x = 0; x < width; x += WORLD_CHUNK)
+        {
+            int count = width - x < WORLD_CHUNK ? width - x : WORLD_CHUNK;
+            uint16_t row = wall_bits(level, y * width + x, count);
+            bits[chunk_of(x, y)][y & (WORLD_CHUNK - 1)] = row;
+            while(row)
+            {
+                int cell = x + __builtin_ctz(row);
+                minimap[y / block][cell / block]++;
+                row &= row - 1;
+            }
+        }
+}
+
+int world_width(void)
+{
+    return width;
+}
+
+int world_height(void)
+{
+    return height;
+}
+
+int world_wrap_x(int x)
+{
+    x %= width;
+    return x < 0 ? x + width : x;
+}
+
+int world_wrap_y(int y)
+{
+    y %= height;
+    return y < 0 ? y + height : y;
+}
+
+bool world_occupied(int x, int y)
+{
+    x = world_wrap_x(x);
+    y = world_wrap_y(y);
+    return (bits[chunk_of(x, y)][y & (WORLD_CHUNK - 1)] >> (x & (WORLD_CHUNK - 1))) & 1;
+}
+
+void world_set(int x, int y, bool occupied)
+{
+    x = world_wrap_x(x);
+    y = world_wrap_y(y);
+    uint16_t* row = &bits[chunk_of(x, y)][y & (WORLD_CHUNK - 1)];
+    uint16_t mask = 1 << (x & (WORLD_CHUNK - 1));
+    if(!(*row & mask) == !occupied)
+        return;
+    *row ^= mask;
+    if(occupied)
+        minimap[y / block][x / block]++;
+    else
+        minimap[y / block][x / block]--;
+}
+
+void world_index_add(world_entry* entry, int x, int y)
+{
+    entry->x = world_wrap_x(x);
+    entry->y = world_wrap_y(y);
+    entry->chunk = chunk_of(entry->x, entry->y);
+    entry->bucket_prev = NULL;
+    entry->bucket_next = buckets[entry->chunk];
+    if(entry->bucket_next)
+        entry->bucket_next->bucket_prev = entry;
+    buckets[entry->chunk] = entry;
+}
+
+void world_index_remove(world_entry* entry)
+{
+    if(entry->bucket_prev)
+        entry->bucket_prev->bucket_next = entry->bucket_next;
+    else
+        buckets[entry->chunk] = entry->bucket_next;
+    if(entry->bucket_next)
+        entry->bucket_next->bucket_prev = entry->bucket_prev;
+}
+
+//the chunks touching the w x h cells starting at (x, y), at most max of them
+static int view_chunks(int x, int y, int w, int h, uint16_t* chunks, int max)
+{
+    //the rectangle may wrap, so mark the chunk columns and rows it crosses
+    uint32_t columns = 0, rows = 0;
+    for(int i = 0; i < w && i < width; i++)
+        columns |= 1u << (world_wrap_x(x + i) >> WORLD_CHUNK_SHIFT);
+    for(int i = 0; i < h && i < height; i++)
+        rows |= 1u << (world_wrap_y(y + i) >> WORLD_CHUNK_SHIFT);
+
+    int count = 0;
+    for(int cy = 0; rows >> cy; cy++)
+        for(int cx = 0; (rows >> cy) & 1 && columns >> cx && count < max; cx++)
+            if((columns >> cx) & 1)
+                chunks[count++] = cy * chunks_x + cx;
+    return count;
+}
+
+bool world_on_camera(const world_camera* camera, int x, int y, int margin, int* view_x, int* view_y)
+{
+    //only wrap to negative what is off screen anyway, small worlds show every cell once
+    int dx = world_wrap_x(x - camera->x);
+    int dy = world_wrap_y(y - camera->y);
+    if(dx >= camera->width + margin && dx >= width - margin)
+        dx -= width;
+    if(dy >= camera->height + margin && dy >= height - margin)
+        dy -= height;
+    *view_x = dx;
+    *view_y = dy;
+    return dx >= -margin && dx < camera->width + margin && dy >= -margin && dy < camera->height + margin;
+}
+
+int world_for_each_visible(const world_camera* camera, int margin, world_visit visit, void* context)
+{
+    uint16_t chunks[VIEW_MAX_CHUNKS];
+    int visited = 0, view_x, view_y;
+    int count = view_chunks(camera->x - margin, camera->y - margin, camera->width + 2 * margin,
+        camera->height + 2 * margin, chunks, VIEW_MAX_CHUNKS);
+    for(int i = 0; i < count; i++)
+        for(world_entry* entry = buckets[chunks[i]]; entry; entry = entry->bucket_next)
+        {
+            visited++;
+            if(world_on_camera(camera, entry->x, entry->y, margin, &view_x, &view_y))
+                visit(entry, view_x, view_y, context);
+        }
+    return visited;
+}
+
+int world_minimap_size(int* w, int* h)
+{
+    *w = (width + block - 1) / block;
+    *h = (height + block - 1) / block;
+    return block;
+}
+
+bool world_minimap_pixel(int x, int y)
+{
+    return minimap[y][x] != 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "level_pack.h"
+
+// The world is a torus of up to 256x256 cells, y = 0 at the bottom.
+// Occupancy (walls and snake) is one bit per cell kept in 16x16 chunks, a chunk
+// row is one uint16_t. Every chunk also heads a list of the entries standing in
+// it, so drawing only has to look at the few chunks under the camera.
+// A count of occupied cells per block of cells backs the minimap.
+
+#define WORLD_MAX_SIZE          256
+#define WORLD_CHUNK_SHIFT       4
+#define WORLD_CHUNK             (1 << WORLD_CHUNK_SHIFT)
+#define WORLD_MAX_CHUNKS_SIDE   (WORLD_MAX_SIZE / WORLD_CHUNK)
+#define WORLD_MAX_CHUNKS        (WORLD_MAX_CHUNKS_SIDE * WORLD_MAX_CHUNKS_SIDE)
+#define WORLD_MINIMAP_SIZE      16      // minimap pixels on the longer side
+
+// Embedded as the first member of anything kept in the spatial index.
+typedef struct world_entry
+{
+    struct world_entry* bucket_next;
+    struct world_entry* bucket_prev;
+    uint16_t chunk;
+    uint8_t x;          // the cell it stands on, fits the padding after chunk
+    uint8_t y;
+} world_entry;
+
+// The part of the world on screen, x, y is its bottom left cell.
+typedef struct world_camera
+{
+    int x;
+    int y;
+    int width;
+    int height;
+} world_camera;
+
+typedef void (*world_visit)(world_entry* entry, int view_x, int view_y, void* context);
+
+// Clears occupancy and the index and stamps the level walls in.
+// Without a level the world is empty and width x height cells big.
+void world_reset(const snake_level* level, int width, int height);
+
+int world_width(void);
+int world_height(void);
+int world_wrap_x(int x);
+int world_wrap_y(int y);
+
+// Coordinates wrap around the world edges.
+bool world_occupied(int x, int y);
+void world_set(int x, int y, bool occupied);
+
+// Entries are indexed by the chunk of the cell they stand on.
+void world_index_add(world_entry* entry, int x, int y);
+void world_index_remove(world_entry* entry);
+
+// Where a cell is on screen in cells. Cells just left of or below the camera come
+// out negative, true when the cell is within margin cells of the screen.
+bool world_on_camera(const world_camera* camera, int x, int y, int margin, int* view_x, int* view_y);
+
+// Calls visit for every indexed entry within margin cells of the screen. Only the
+// chunks under the camera are searched, which covers cameras up to 47 cells a side
+// with a margin of 1. Returns how many entries were looked at.
+int world_for_each_visible(const world_camera* camera, int margin, world_visit visit, void* context);
+
+// Size of the minimap in pixels, returns how many cells a pixel covers per side.
+int world_minimap_size(int* width, int* height);
+bool world_minimap_pixel(int x, int y);
@@ -0,0 +1,131 @@
+// Drives main/display_spi.c the way u8g2_SendBuffer does for an SH1106 and
+// runs it against the spi_master mock, then puts the numbers next to a model of
+// the I2C path, which blocks for the whole transfer.
+//
+//   gcc -O2 -Itools/host_shim -Imain -o display_bus_sim
+//       tools/display_bus_sim/*.c main/display_spi.c
+//   ./display_bus_sim [--frames N] [--logic-us US] [--spi-hz HZ] [--i2c-hz HZ]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "display_spi.h"
+#include "spi_mock.h"
+
+#define PIN_DC          17
+#define SH1106_OFFSET   2
+#define I2C_CHUNK       32      // data bytes per I2C transfer
+#define I2C_OVERHEAD_US 20      // driver cost per I2C transfer
+
+static uint8_t frame[1024];
+
+//what u8x8_d_sh1106_128x64_noname and u8x8_cad_001 send for one full buffer
+static void send_buffer(const uint8_t* buf)
+{
+    for(int page = 0; page < 8; page++)
+    {
+        uint8_t cmds[] = { 0x10 | SH1106_OFFSET >> 4, SH1106_OFFSET & 0x0F, 0xB0 | page };
+        display_spi_byte_cb(NULL, U8X8_MSG_BYTE_START_TRANSFER, 0, NULL);
+        for(int i = 0; i < 3; i++)
+        {
+            display_spi_byte_cb(NULL, U8X8_MSG_BYTE_SET_DC, 0, NULL);
+            display_spi_byte_cb(NULL, U8X8_MSG_BYTE_SEND, 1, &cmds[i]);
+        }
+        display_spi_byte_cb(NULL, U8X8_MSG_BYTE_SET_DC, 1, NULL);
+        display_spi_byte_cb(NULL, U8X8_MSG_BYTE_SEND, 128, (void*)(buf + page * 128));
+        display_spi_byte_cb(NULL, U8X8_MSG_BYTE_END_TRANSFER, 0, NULL);
+    }
+}
+
+static void next_frame(int n)
+{
+    //a scene change now and then, otherwise the snake moves a few pixels
+    if(n % 50 == 0)
+        for(int i = 0; i < 1024; i++)
+            frame[i] = rand();
+    else
+        for(int i = 0; i < 4; i++)
+            frame[rand() % 1024] ^= 1 << (rand() % 8);
+}
+
+static double i2c_frame_us(int hz)
+{
+    //per page: one command transfer of 3 bytes, then the 128 data bytes in chunks,
+    //each transfer adds the address and control bytes, start and stop
+    double bits = 0;
+    int transfers = 0;
+    for(int page = 0; page < 8; page++)
+    {
+        bits += (2 + 3) * 9 + 2;
+        transfers++;
+        for(int done = 0; done < 128; done += I2C_CHUNK)
+        {
+            bits += (2 + I2C_CHUNK) * 9 + 2;
+            transfers++;
+        }
+    }
+    return bits * 1e6 / hz + transfers * I2C_OVERHEAD_US;
+}
+
+int main(int argc, char** argv)
+{
+    int frames = 500, logic_us = 2000, spi_hz = 8000000, i2c_hz = 400000;
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        if(!strcmp(argv[i], "--frames"))
+            frames = atoi(argv[i + 1]);
+        else if(!strcmp(argv[i], "--logic-us"))
+            logic_us = atoi(argv[i + 1]);
+        else if(!strcmp(argv[i], "--spi-hz"))
+            spi_hz = atoi(argv[i + 1]);
+        else if(!strcmp(argv[i], "--i2c-hz"))
+            i2c_hz = atoi(argv[i + 1]);
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    spi_mock_params params = { .queue_us = 4, .trans_overhead_us = 8, .dc_pin = PIN_DC };
+    spi_mock_set_params(&params);
+    display_spi_config config = {
+        .host = 1, .clk = 18, .mosi = 23, .cs = 5, .dc = PIN_DC, .reset = -1, .clock_hz = spi_hz,
+    };
+    display_spi_init(&config);
+
+    //bytes outside a transfer are refused, not written through a stale slot
+    int unpaired = display_spi_byte_cb(NULL, U8X8_MSG_BYTE_SEND, 1, (void*)frame) +
+        display_spi_byte_cb(NULL, U8X8_MSG_BYTE_END_TRANSFER, 0, NULL);
+
+    //game loop: send the frame, then the logic of the next tick runs while DMA drains the queue
+    double send_us = 0, latency_us = 0;
+    int bad = 0;
+    for(int n = 0; n < frames; n++)
+    {
+        next_frame(n);
+        double start = spi_mock_now();
+        send_buffer(frame);
+        send_us += spi_mock_now() - start;
+        latency_us += spi_mock_bus_free() - start;
+        spi_mock_advance(logic_us);
+        if(spi_mock_now() >= spi_mock_bus_free() && !spi_mock_panel_matches(frame))
+            bad++;
+    }
+    display_spi_flush();
+    if(!spi_mock_panel_matches(frame))
+        bad++;
+
+    const display_spi_stats* stats = display_spi_get_stats();
+    const spi_mock_stats* mock = spi_mock_get_stats();
+    printf("spi %d Hz: %u transactions, %u bytes per frame\n", spi_hz,
+        mock->transactions / frames, mock->bytes / frames);
+    printf("  send (cpu) %.0f us/frame, blocked %.0f us/frame, wire %.0f us/frame, "
+        "panel updated %.0f us after send\n", send_us / frames, (double)stats->blocked_us / frames,
+        (double)stats->wire_us / frames, latency_us / frames);
+    printf("i2c %d Hz model: %.0f us/frame, all of it blocking\n", i2c_hz, i2c_frame_us(i2c_hz));
+    printf("%d frames, %d corrupted, %u queue errors, %d unpaired messages accepted\n", frames, bad,
+        mock->errors, unpaired);
+    return (bad || mock->errors || unpaired) ? 2 : 0;
+}
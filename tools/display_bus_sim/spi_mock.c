@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "spi_mock.h"
+
+// Virtual clock: the CPU side advances it by fixed costs, the bus runs queued
+// transactions back to back behind it, like the DMA engine would. A transaction
+// only reads its buffer once its slot on the bus has come, so reusing a buffer
+// too early corrupts the panel just like on hardware.
+
+#define MOCK_QUEUE_MAX  64
+
+static spi_mock_params params = {
+    .queue_us = 4,
+    .trans_overhead_us = 8,
+    .dc_pin = 17,
+};
+static double now_us = 0;
+static double bus_free_us = 0;
+static spi_device_interface_config_t device;
+static spi_transaction_t* pending[MOCK_QUEUE_MAX];
+static double start_at[MOCK_QUEUE_MAX], done_at[MOCK_QUEUE_MAX];
+static int head = 0, count = 0, executed = 0;
+static int levels[64];
+static uint8_t panel[8][132];
+static int panel_page = 0, panel_column = 0;
+static spi_mock_stats stats;
+
+void spi_mock_set_params(const spi_mock_params* p)
+{
+    params = *p;
+}
+
+static void run_bus();
+
+void spi_mock_advance(uint32_t us)
+{
+    now_us += us;
+    run_bus();
+}
+
+double spi_mock_now(void)
+{
+    return now_us;
+}
+
+double spi_mock_bus_free(void)
+{
+    return bus_free_us;
+}
+
+const spi_mock_stats* spi_mock_get_stats(void)
+{
+    return &stats;
+}
+
+// SH1106 RAM is 132 columns wide, the 128 visible ones start at column 2.
+int spi_mock_panel_matches(const uint8_t* frame)
+{
+    for(int page = 0; page < 8; page++)
+        if(memcmp(panel[page] + 2, frame + page * 128, 128))
+            return 0;
+    return 1;
+}
+
+static void panel_write(int dc, const uint8_t* data, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+    {
+        if(dc)
+        {
+            if(panel_column < 132)
+                panel[panel_page][panel_column] = data[i];
+            panel_column++;
+        }
+        else if((data[i] & 0xF0) == 0xB0)
+            panel_page = data[i] & 0x07;
+        else if((data[i] & 0xF0) == 0x00)
+            panel_column = (panel_column & 0xF0) | (data[i] & 0x0F);
+        else if((data[i] & 0xF0) == 0x10)
+            panel_column = (panel_column & 0x0F) | (data[i] & 0x0F) << 4;
+    }
+}
+
+esp_err_t gpio_reset_pin(int gpio)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(int gpio, int mode)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(int gpio, uint32_t level)
+{
+    levels[gpio & 63] = level;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_initialize(int host, const spi_bus_config_t* bus, int dma_chan)
+{
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(int host, const spi_device_interface_config_t* dev,
+    spi_device_handle_t* handle)
+{
+    device = *dev;
+    *handle = (spi_device_handle_t)&device;
+    return ESP_OK;
+}
+
+//runs every queued transaction whose bus slot has started by now, reading its buffer only then
+static void run_bus()
+{
+    double cpu_us = now_us;
+    while(executed < count && start_at[(head + executed) % MOCK_QUEUE_MAX] <= cpu_us)
+    {
+        int slot = (head + executed) % MOCK_QUEUE_MAX;
+        spi_transaction_t* trans = pending[slot];
+        now_us = start_at[slot];
+        if(device.pre_cb)
+            device.pre_cb(trans);
+        panel_write(levels[params.dc_pin & 63], trans->tx_buffer, trans->length / 8);
+        now_us = done_at[slot];
+        if(device.post_cb)
+            device.post_cb(trans);
+        executed++;
+    }
+    now_us = cpu_us;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* trans,
+    TickType_t ticks)
+{
+    if(count == device.queue_size || count == MOCK_QUEUE_MAX)
+    {
+        fprintf(stderr, "spi queue overflow\n");
+        stats.errors++;
+        return ESP_ERR_INVALID_STATE;
+    }
+    now_us += params.queue_us;
+
+    int slot = (head + count) % MOCK_QUEUE_MAX;
+    pending[slot] = trans;
+    start_at[slot] = (bus_free_us > now_us) ? bus_free_us : now_us;
+    done_at[slot] = start_at[slot] + params.trans_overhead_us +
+        trans->length * 1e6 / device.clock_speed_hz;
+    bus_free_us = done_at[slot];
+    count++;
+    stats.transactions++;
+    stats.bytes += trans->length / 8;
+    run_bus();
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** trans,
+    TickType_t ticks)
+{
+    if(!count)
+        return ESP_ERR_INVALID_STATE;
+    if(done_at[head] > now_us)
+        now_us = done_at[head];
+    run_bus();
+    *trans = pending[head];
+    head = (head + 1) % MOCK_QUEUE_MAX;
+    count--;
+    executed--;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return (int64_t)now_us;
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    spi_mock_advance(us);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    spi_mock_advance(ticks * 1000);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+// Bus-level mock of the ESP-IDF spi_master driver with an SH1106 on the other
+// end. Transactions are timed on a virtual clock and the bytes land in a model
+// of the panel RAM, interpreted as commands or data by the DC pin level the
+// pre-transfer hook set, so a wrong DC shows up as a corrupted picture.
+
+typedef struct spi_mock_params
+{
+    uint32_t queue_us;              // CPU cost of spi_device_queue_trans
+    uint32_t trans_overhead_us;     // per transaction setup on the bus
+    int dc_pin;
+} spi_mock_params;
+
+typedef struct spi_mock_stats
+{
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t errors;
+} spi_mock_stats;
+
+void spi_mock_set_params(const spi_mock_params* params);
+
+// Moves the virtual clock as if the CPU was busy for us.
+void spi_mock_advance(uint32_t us);
+double spi_mock_now(void);
+double spi_mock_bus_free(void);
+
+int spi_mock_panel_matches(const uint8_t* frame);
+const spi_mock_stats* spi_mock_get_stats(void);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define GPIO_MODE_INPUT     1
+#define GPIO_MODE_OUTPUT    2
+
+esp_err_t gpio_reset_pin(int gpio);
+esp_err_t gpio_set_direction(int gpio, int mode);
+esp_err_t gpio_set_level(int gpio, uint32_t level);
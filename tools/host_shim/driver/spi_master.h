@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#define SPI2_HOST       1
+#define SPI_DMA_CH_AUTO 3
+
+typedef struct spi_transaction_t spi_transaction_t;
+typedef void (*transaction_cb_t)(spi_transaction_t* trans);
+typedef struct spi_device_t* spi_device_handle_t;
+
+struct spi_transaction_t
+{
+    uint32_t flags;
+    size_t length;          // bits
+    size_t rxlength;
+    void* user;
+    const void* tx_buffer;
+    void* rx_buffer;
+};
+
+typedef struct spi_bus_config_t
+{
+    int mosi_io_num;
+    int miso_io_num;
+    int sclk_io_num;
+    int quadwp_io_num;
+    int quadhd_io_num;
+    int max_transfer_sz;
+} spi_bus_config_t;
+
+typedef struct spi_device_interface_config_t
+{
+    uint8_t mode;
+    int clock_speed_hz;
+    int spics_io_num;
+    int queue_size;
+    transaction_cb_t pre_cb;
+    transaction_cb_t post_cb;
+} spi_device_interface_config_t;
+
+esp_err_t spi_bus_initialize(int host, const spi_bus_config_t* bus, int dma_chan);
+esp_err_t spi_bus_add_device(int host, const spi_device_interface_config_t* dev,
+    spi_device_handle_t* handle);
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* trans,
+    TickType_t ticks);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** trans,
+    TickType_t ticks);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#define UART_DATA_8_BITS            3
+#define UART_PARITY_DISABLE         0
+#define UART_STOP_BITS_1            1
+#define UART_HW_FLOWCTRL_DISABLE    0
+#define UART_SCLK_DEFAULT           0
+#define UART_PIN_NO_CHANGE          (-1)
+
+typedef struct
+{
+    int baud_rate;
+    int data_bits;
+    int parity;
+    int stop_bits;
+    int flow_ctrl;
+    int source_clk;
+} uart_config_t;
+
+esp_err_t uart_driver_install(int uart_num, int rx_buffer_size, int tx_buffer_size,
+    int queue_size, void* uart_queue, int intr_alloc_flags);
+esp_err_t uart_param_config(int uart_num, const uart_config_t* config);
+esp_err_t uart_set_pin(int uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
+int uart_write_bytes(int uart_num, const void* src, size_t size);
@@ -0,0 +1,20 @@
+#pragma once
+
+// Host shims: just enough of ESP-IDF for the modules in main/ that the host
+// tools run on a PC.
+
+#include <stdlib.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_INVALID_SIZE    0x104
+#define ESP_ERR_NOT_FOUND       0x105
+#define ESP_ERR_INVALID_CRC     0x109
+
+#define esp_err_to_name(err)    "esp_err"
+#define ESP_ERROR_CHECK(x)      do { if((x) != ESP_OK) abort(); } while(0)
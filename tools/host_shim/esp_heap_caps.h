@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_DMA  (1 << 3)
+
+static inline void* heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define ESP_PARTITION_TYPE_DATA     1
+#define ESP_PARTITION_MMAP_DATA     0
+
+typedef int esp_partition_mmap_handle_t;
+
+typedef struct esp_partition_t
+{
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_size;
+    const char* label;
+} esp_partition_t;
+
+const esp_partition_t* esp_partition_find_first(int type, int subtype, const char* label);
+esp_err_t esp_partition_mmap(const esp_partition_t* partition, size_t offset, size_t size,
+    int memory, const void** out_ptr, esp_partition_mmap_handle_t* out_handle);
+void esp_partition_munmap(esp_partition_mmap_handle_t handle);
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t offset, const void* src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size);
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+
+#define pdTRUE          1
+#define pdPASS          1
+#define portMAX_DELAY   0xFFFFFFFF
+#define portTICK_PERIOD_MS 1
@@ -0,0 +1,6 @@
+#pragma once
+
+// single threaded host, the lock never blocks
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) { return (SemaphoreHandle_t)1; }
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t lock, TickType_t ticks) { return pdTRUE; }
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t lock) { return pdTRUE; }
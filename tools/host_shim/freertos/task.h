@@ -0,0 +1,12 @@
+#pragma once
+
+// no background task on the host, the simulator calls score_log_compact() itself
+static inline BaseType_t xTaskCreate(void (*fn)(void*), const char* name, uint32_t stack,
+    void* arg, int prio, TaskHandle_t* handle)
+{
+    *handle = NULL;
+    return pdPASS;
+}
+static inline void xTaskNotifyGive(TaskHandle_t task) { }
+void vTaskDelay(TickType_t ticks);
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) { return 0; }
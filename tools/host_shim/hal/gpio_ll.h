@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include "driver/gpio.h"
+
+// Register level GPIO, forwarded to gpio_set_level so the host mocks see it.
+
+typedef struct gpio_dev_t
+{
+    int unused;
+} gpio_dev_t;
+
+static gpio_dev_t GPIO;
+
+static inline void gpio_ll_set_level(gpio_dev_t* hw, uint32_t gpio_num, uint32_t level)
+{
+    gpio_set_level(gpio_num, level);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+// Only the u8x8 callback interface, the host tools drive the callbacks directly,
+// and the frame buffer access the mirror needs.
+
+typedef struct u8x8_struct u8x8_t;
+typedef struct u8g2_struct u8g2_t;
+
+uint8_t* u8g2_GetBufferPtr(u8g2_t* u8g2);
+
+#define U8X8_MSG_DELAY_MILLI            41
+#define U8X8_MSG_DELAY_10MICRO          42
+#define U8X8_MSG_DELAY_100NANO          43
+#define U8X8_MSG_GPIO_RESET             75
+#define U8X8_MSG_BYTE_SEND              23
+#define U8X8_MSG_BYTE_START_TRANSFER    24
+#define U8X8_MSG_BYTE_END_TRANSFER      25
+#define U8X8_MSG_BYTE_SET_DC            32
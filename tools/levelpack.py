@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""Compile ASCII level files into the snake level pack and verify packs.
+
+Level file format, one level per file:
+
+    name: Box          (optional, defaults to the file name)
+    speed: 60          (optional, tick length in ms)
+    apple: 9           (optional, points per apple)
+    ####################
+    #..................#
+    ...
+
+Every row of the grid is one row of the world and all rows are as long as the
+longest one, short rows are padded with empty cells. Worlds run from 5x1 up to
+256x256 cells and wrap around at the edges, the top row is the top of the
+world. '#' is a wall, '.' or ' ' is empty and a single 'S' marks the spawn cell
+of the snake head. The snake spawns heading right with its body trailing three
+cells to the left. Worlds larger than the 20x10 screen scroll with the snake.
+
+    levelpack.py build -o levels.bin levels/*.txt
+    levelpack.py verify [--show] levels.bin
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+MIN_WIDTH = 5
+MAX_SIZE = 256
+
+MAGIC = 0x4C4B4E53
+VERSION = 2
+NAME_LEN = 16
+HEADER = struct.Struct('<IBBHII')
+RECORD = struct.Struct('<%dsHHHHHBx' % NAME_LEN)
+
+
+class LevelError(Exception):
+    pass
+
+
+def parse_level(path):
+    level = {'name': os.path.splitext(os.path.basename(path))[0],
+             'speed': 0, 'apple': 0}
+    rows = []
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.rstrip('\r\n')
+            key, sep, value = line.partition(':')
+            if sep and key.strip() in ('name', 'speed', 'apple'):
+                key = key.strip()
+                level[key] = value.strip() if key == 'name' else int(value)
+            elif line.strip():
+                rows.append((lineno, line))
+
+    height = len(rows)
+    width = max([len(line) for _, line in rows] or [0])
+    if not (MIN_WIDTH <= width <= MAX_SIZE and 1 <= height <= MAX_SIZE):
+        raise LevelError('%s: %dx%d is outside %dx1 to %dx%d' % (
+            path, width, height, MIN_WIDTH, MAX_SIZE, MAX_SIZE))
+
+    walls = [[False] * width for _ in range(height)]
+    spawn = None
+    for row, (lineno, line) in enumerate(rows):
+        y = height - 1 - row
+        for x, c in enumerate(line):
+            if c == '#':
+                walls[y][x] = True
+            elif c == 'S':
+                if spawn:
+                    raise LevelError('%s:%d: second spawn point' % (path, lineno))
+                spawn = (x, y)
+            elif c not in '. ':
+                raise LevelError('%s:%d: unknown cell %r' % (path, lineno, c))
+    if not spawn:
+        raise LevelError('%s: no spawn point' % path)
+
+    level['size'] = (width, height)
+    level['walls'] = walls
+    level['spawn'] = spawn
+    check_level(level, path)
+    return level
+
+
+def check_level(level, where):
+    walls = level['walls']
+    width, height = level['size']
+    if not (MIN_WIDTH <= width <= MAX_SIZE and 1 <= height <= MAX_SIZE):
+        raise LevelError('%s: bad size %dx%d' % (where, width, height))
+    x, y = level['spawn']
+    if not (0 <= x < width and 0 <= y < height):
+        raise LevelError('%s: spawn out of the map' % where)
+    # body trails left of the head and the first move goes right
+    for dx in (-3, -2, -1, 0, 1):
+        if walls[y][(x + dx) % width]:
+            raise LevelError('%s: spawn at (%d,%d) runs into a wall' % (where, x, y))
+    if not 0 <= level['speed'] <= 0xFFFF or not 0 <= level['apple'] <= 0xFF:
+        raise LevelError('%s: speed or apple override out of range' % where)
+    if len(level['name'].encode()) > NAME_LEN:
+        raise LevelError('%s: name longer than %d bytes' % (where, NAME_LEN))
+
+
+def wall_bytes(width, height):
+    return (width * height + 7) // 8
+
+
+def pack_walls(walls, width, height):
+    data = bytearray(wall_bytes(width, height))
+    for y in range(height):
+        for x in range(width):
+            if walls[y][x]:
+                bit = y * width + x
+                data[bit >> 3] |= 1 << (bit & 7)
+    return bytes(data)
+
+
+def unpack_walls(data, width, height):
+    return [[bool(data[(y * width + x) >> 3] >> ((y * width + x) & 7) & 1)
+             for x in range(width)] for y in range(height)]
+
+
+def build(levels):
+    if len(levels) > 0xFF:
+        raise LevelError('too many levels')
+    offset = HEADER.size + 4 * len(levels)
+    offsets, records = [], b''
+    for level in levels:
+        width, height = level['size']
+        record = RECORD.pack(level['name'].encode(), width, height, level['spawn'][0],
+                             level['spawn'][1], level['speed'], level['apple'])
+        record += pack_walls(level['walls'], width, height)
+        record = record.ljust((len(record) + 3) & ~3, b'\0')
+        offsets.append(offset)
+        records += record
+        offset += len(record)
+    body = struct.pack('<%dI' % len(levels), *offsets) + records
+    return HEADER.pack(MAGIC, VERSION, len(levels), 0, len(body), zlib.crc32(body)) + body
+
+
+def verify(data):
+    if len(data) < HEADER.size:
+        raise LevelError('pack shorter than its header')
+    magic, version, count, _, size, crc = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        raise LevelError('bad magic or version')
+    body = data[HEADER.size:HEADER.size + size]
+    if len(body) != size or size < 4 * count:
+        raise LevelError('pack truncated')
+    if zlib.crc32(body) != crc:
+        raise LevelError('crc mismatch')
+
+    levels = []
+    for i, offset in enumerate(struct.unpack_from('<%dI' % count, body)):
+        if offset % 4 or offset < HEADER.size or offset + RECORD.size > HEADER.size + size:
+            raise LevelError('level %d: bad offset %d' % (i, offset))
+        name, width, height, spawn_x, spawn_y, speed, apple = RECORD.unpack_from(data, offset)
+        walls = data[offset + RECORD.size:offset + RECORD.size + wall_bytes(width, height)]
+        if offset + RECORD.size + wall_bytes(width, height) > HEADER.size + size:
+            raise LevelError('level %d: walls run past the pack' % i)
+        level = {'name': name.rstrip(b'\0').decode(), 'size': (width, height),
+                 'spawn': (spawn_x, spawn_y), 'speed': speed, 'apple': apple,
+                 'walls': unpack_walls(walls, width, height)}
+        check_level(level, 'level %d' % i)
+        levels.append(level)
+    return levels
+
+
+def show(level):
+    width, height = level['size']
+    print('%s  %dx%d spawn=%s speed=%s apple=%s' % (level['name'], width, height, level['spawn'],
+          level['speed'] or 'default', level['apple'] or 'default'))
+    for y in reversed(range(height)):
+        print(''.join('S' if (x, y) == level['spawn'] else '#' if level['walls'][y][x] else '.'
+                      for x in range(width)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest='command', required=True)
+    build_parser = sub.add_parser('build', help='compile level files into a pack')
+    build_parser.add_argument('-o', '--output', required=True)
+    build_parser.add_argument('levels', nargs='+')
+    verify_parser = sub.add_parser('verify', help='check a pack')
+    verify_parser.add_argument('--show', action='store_true', help='print every level')
+    verify_parser.add_argument('pack')
+    args = parser.parse_args()
+
+    try:
+        if args.command == 'build':
+            data = build([parse_level(path) for path in sorted(args.levels)])
+            with open(args.output, 'wb') as f:
+                f.write(data)
+            print('%s: %d levels, %d bytes' % (args.output, data[5], len(data)))
+        else:
+            with open(args.pack, 'rb') as f:
+                levels = verify(f.read())
+            for level in levels if args.show else []:
+                show(level)
+            print('%s: %d levels ok' % (args.pack, len(levels)))
+    except LevelError as e:
+        sys.exit('error: %s' % e)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Decode a tools/mirror_sim capture with mirror_view.Decoder and compare frames.
+
+    mirror_check.py capture.bin frames.bin
+    mirror_check.py capture.bin frames.bin --log-between 256
+    mirror_check.py capture.bin frames.bin --log-inside 256
+
+frames.bin holds every frame given to the mirror, dropped packets included. A
+decoded frame is matched to its source by the packet sequence numbers.
+
+--log-between and --log-inside splice a console log line into the stream every
+N packets, between two packets or in the middle of one, like ESP_LOG does when
+it shares the mirror UART. Logs between packets must cost no frames. A log
+inside a packet costs the frames up to the next key frame, but no frame may
+ever decode wrong.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+from mirror_view import Decoder, FRAME_SIZE  # noqa: E402
+
+LOG_LINE = b'I (123456) screen_mirror: 44 bytes/frame of 1024 raw, encode 310 us/frame\n'
+
+
+def split_packets(capture):
+    """The capture is clean, so the length fields walk it packet by packet."""
+    packets, pos = [], 0
+    while pos + 6 <= len(capture):
+        length = struct.unpack_from('<H', capture, pos + 4)[0]
+        packets.append(capture[pos:pos + 8 + length])
+        pos += 8 + length
+    return packets
+
+
+def splice_logs(capture, every, inside):
+    out = bytearray()
+    for i, packet in enumerate(split_packets(capture)):
+        if (i + 1) % every:
+            out += packet
+        elif inside:
+            out += packet[:len(packet) // 2] + LOG_LINE + packet[len(packet) // 2:]
+        else:
+            out += LOG_LINE + packet
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('capture')
+    parser.add_argument('frames')
+    logs = parser.add_mutually_exclusive_group()
+    logs.add_argument('--log-between', type=int, metavar='N', help='log line before every Nth packet')
+    logs.add_argument('--log-inside', type=int, metavar='N', help='log line inside every Nth packet')
+    args = parser.parse_args()
+
+    with open(args.capture, 'rb') as f:
+        capture = f.read()
+    with open(args.frames, 'rb') as f:
+        sources = f.read()
+    total = len(sources) // FRAME_SIZE
+    if args.log_between:
+        capture = splice_logs(capture, args.log_between, False)
+    elif args.log_inside:
+        capture = splice_logs(capture, args.log_inside, True)
+
+    decoder = Decoder()
+    index = prev_seq = None
+    checked = bad = 0
+    for frame in decoder.feed(capture):
+        seq = (decoder.next_seq - 1) & 0xFF
+        index = seq if index is None else index + ((seq - prev_seq) & 0xFF)
+        prev_seq = seq
+        if index >= total or frame != sources[index * FRAME_SIZE:(index + 1) * FRAME_SIZE]:
+            bad += 1
+        checked += 1
+
+    print('%d of %d frames decoded, %d packets lost, %d mismatches' % (
+        checked, total, decoder.dropped, bad))
+    failed = bad or not checked
+    if args.log_between and checked != total:
+        print('logs between packets cost frames')
+        failed = True
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,184 @@
+// Runs main/screen_mirror.c on the host against game-like frames. Writes what
+// the mirror would send over the UART and the frames it was given, so
+// tools/mirror_sim/mirror_check.py can decode the stream with tools/mirror_view.py
+// and compare.
+//
+//   gcc -O2 -Itools/host_shim -Imain -o mirror_sim
+//       tools/mirror_sim/mirror_sim.c main/screen_mirror.c
+//   ./mirror_sim capture.bin frames.bin [--frames N] [--drop N]   (drop every Nth packet)
+//   python tools/mirror_sim/mirror_check.py capture.bin frames.bin
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "driver/uart.h"
+#include "esp_timer.h"
+#include "screen_mirror.h"
+
+#define MAP_WIDTH 20
+#define MAP_HEIGHT 10
+#define MAX_LENGTH 64
+
+static uint8_t frame[1024];
+static FILE* capture;
+static int packets = 0, drop_every = 0;
+
+uint8_t* u8g2_GetBufferPtr(u8g2_t* u8g2)
+{
+    return frame;
+}
+
+esp_err_t uart_driver_install(int uart_num, int rx_buffer_size, int tx_buffer_size,
+    int queue_size, void* uart_queue, int intr_alloc_flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_param_config(int uart_num, const uart_config_t* config)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(int uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+    return ESP_OK;
+}
+
+int uart_write_bytes(int uart_num, const void* src, size_t size)
+{
+    packets++;
+    if(!drop_every || packets % drop_every)
+        fwrite(src, 1, size, capture);
+    return size;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static void pixel(int x, int y)
+{
+    if(x >= 0 && x < 128 && y >= 0 && y < 64)
+        frame[(y >> 3) * 128 + x] |= 1 << (y & 7);
+}
+
+//3x5 digits, a column per nibble bit, enough to make the score change like in the game
+static void draw_number(int x, int y, int value)
+{
+    static const uint16_t digits[10] = { 0x7B6F, 0x2492, 0x73E7, 0x73CF, 0x5BC9,
+                                         0x79CF, 0x79EF, 0x7249, 0x7BEF, 0x7BCF };
+    for(int i = 3; i >= 0; i--, value /= 10)
+        for(int bit = 0; bit < 15; bit++)
+            if(digits[value % 10] >> (14 - bit) & 1)
+                pixel(x + i * 4 + bit % 3, y + bit / 3);
+}
+
+static void draw_cell(int x, int y, bool full)
+{
+    int px = 23 + 4 * x, py = 64 - (4 + 4 * y) - 3;
+    pixel(px + 1, py + 1);
+    pixel(px + 2, py + 2);
+    if(full)
+    {
+        pixel(px + 2, py + 1);
+        pixel(px + 1, py + 2);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char *capture_path = NULL, *frames_path = NULL;
+    int frames = 2000;
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "--frames") && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--drop") && i + 1 < argc)
+            drop_every = atoi(argv[++i]);
+        else if(argv[i][0] != '-' && !capture_path)
+            capture_path = argv[i];
+        else if(argv[i][0] != '-' && !frames_path)
+            frames_path = argv[i];
+        else
+        {
+            fprintf(stderr, "usage: %s CAPTURE FRAMES [--frames N] [--drop N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(!capture_path || !frames_path)
+        return 1;
+    capture = fopen(capture_path, "wb");
+    FILE* frames_out = fopen(frames_path, "wb");
+    if(!capture || !frames_out)
+    {
+        perror("open");
+        return 1;
+    }
+
+    //a snake wandering the 20x10 map, eating an apple now and then
+    int xs[MAX_LENGTH], ys[MAX_LENGTH], length = 4, direction = 0, score = 0;
+    int apple_x = 5, apple_y = 5;
+    for(int i = 0; i < length; i++)
+    {
+        xs[i] = 12 - i;
+        ys[i] = 5;
+    }
+    srand(1);
+    screen_mirror_init(1, 25, 115200);
+    for(int f = 0; f < frames; f++)
+    {
+        if(rand() % 6 == 0)
+            direction = (direction + (rand() % 2 ? 1 : 3)) % 4;
+        memmove(xs + 1, xs, (MAX_LENGTH - 1) * sizeof(int));
+        memmove(ys + 1, ys, (MAX_LENGTH - 1) * sizeof(int));
+        xs[0] = (xs[1] + (direction == 0) - (direction == 2) + MAP_WIDTH) % MAP_WIDTH;
+        ys[0] = (ys[1] + (direction == 1) - (direction == 3) + MAP_HEIGHT) % MAP_HEIGHT;
+        if(xs[0] == apple_x && ys[0] == apple_y)
+        {
+            score += 7;
+            length = length < MAX_LENGTH ? length + 1 : 4;
+            apple_x = rand() % MAP_WIDTH;
+            apple_y = rand() % MAP_HEIGHT;
+        }
+        else if(rand() % 40 == 0)
+        {
+            apple_x = rand() % MAP_WIDTH;
+            apple_y = rand() % MAP_HEIGHT;
+        }
+
+        memset(frame, 0, sizeof(frame));
+        for(int x = 21; x <= 104; x++)
+        {
+            pixel(x, 62);
+            pixel(x, 19);
+            pixel(x, 17);
+        }
+        for(int y = 19; y <= 62; y++)
+        {
+            pixel(21, y);
+            pixel(104, y);
+        }
+        draw_number(50, 8, score % 10000);
+        for(int i = 0; i < length; i++)
+            draw_cell(xs[i], ys[i], i == 0);
+        draw_cell(apple_x, apple_y, f & 1);
+
+        screen_mirror_frame(NULL);
+        fwrite(frame, 1, sizeof(frame), frames_out);
+    }
+    fclose(capture);
+    fclose(frames_out);
+
+    const screen_mirror_stats* stats = screen_mirror_get_stats();
+    printf("%u frames, %.1f bytes/frame (%.1f%% of 1024 raw), encode %.2f us/frame on this host, "
+        "%d packets dropped\n", stats->frames, (double)stats->bytes / stats->frames,
+        100.0 * stats->bytes / stats->frames / 1024, (double)stats->encode_us / stats->frames,
+        drop_every ? packets / drop_every : 0);
+    return 0;
+}
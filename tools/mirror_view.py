@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+"""Rebuild the OLED frames streamed by main/screen_mirror.c.
+
+    mirror_view.py --port /dev/ttyUSB0 --show
+    mirror_view.py --input capture.bin --pbm frames/ --gif game.gif
+
+Log lines on the same UART are skipped, packets are found by their sync bytes
+and checksum. After a lost packet deltas are ignored until the next key frame.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+WIDTH = 128
+HEIGHT = 64
+FRAME_SIZE = WIDTH * HEIGHT // 8
+TILES = FRAME_SIZE // 8
+MASK_SIZE = TILES // 8
+SYNC = b'\xa5\x5a'
+KEY = 1
+
+
+def fletcher16(data):
+    a = b = 0
+    for byte in data:
+        a = (a + byte) % 255
+        b = (b + a) % 255
+    return b << 8 | a
+
+
+def rle_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        n = data[i]
+        if n < 0x80:
+            out += data[i + 1:i + 2 + n]
+            i += 2 + n
+        else:
+            out += bytes([data[i + 1]]) * (n - 0x7F)
+            i += 2
+    return bytes(out)
+
+
+class Decoder:
+    def __init__(self):
+        self.buf = bytearray()
+        self.frame = bytearray(FRAME_SIZE)
+        self.synced = False
+        self.next_seq = None
+        self.frames = 0
+        self.packet_bytes = 0
+        self.dropped = 0
+
+    def feed(self, data):
+        """Yields a copy of the frame buffer for every frame decoded from data."""
+        self.buf += data
+        while True:
+            start = self.buf.find(SYNC)
+            if start < 0:
+                del self.buf[:-1]
+                return
+            del self.buf[:start]
+            if len(self.buf) < 6:
+                return
+            ptype, seq, length = struct.unpack_from('<BBH', self.buf, 2)
+            if length > MASK_SIZE + FRAME_SIZE + FRAME_SIZE // 128:
+                del self.buf[:2]
+                continue
+            if len(self.buf) < 8 + length:
+                return
+            packet = bytes(self.buf[:8 + length])
+            if struct.unpack_from('<H', packet, 6 + length)[0] != fletcher16(packet[2:6 + length]):
+                del self.buf[:2]
+                continue
+            del self.buf[:8 + length]
+
+            if self.next_seq is not None and seq != self.next_seq:
+                self.dropped += (seq - self.next_seq) & 0xFF
+                self.synced = False
+            self.next_seq = (seq + 1) & 0xFF
+            if ptype == KEY:
+                self.frame = bytearray(FRAME_SIZE)
+                self.synced = True
+            if not self.synced:
+                continue
+
+            payload = packet[6:6 + length]
+            if payload:
+                mask, delta = payload[:MASK_SIZE], rle_decode(payload[MASK_SIZE:])
+                pos = 0
+                for tile in range(TILES):
+                    if mask[tile >> 3] >> (tile & 7) & 1:
+                        for k in range(8):
+                            self.frame[tile * 8 + k] ^= delta[pos + k]
+                        pos += 8
+            self.frames += 1
+            self.packet_bytes += len(packet)
+            yield bytes(self.frame)
+
+
+def pixel(frame, x, y):
+    return frame[(y >> 3) * WIDTH + x] >> (y & 7) & 1
+
+
+def to_pbm(frame):
+    rows = bytearray()
+    for y in range(HEIGHT):
+        for xb in range(0, WIDTH, 8):
+            byte = 0
+            for x in range(xb, xb + 8):
+                byte = byte << 1 | (pixel(frame, x, y) ^ 1)  # PBM 1 is black, lit pixels are white
+            rows.append(byte)
+    return b'P4\n%d %d\n' % (WIDTH, HEIGHT) + bytes(rows)
+
+
+def show(frame):
+    lines = []
+    for y in range(0, HEIGHT, 2):
+        lines.append(''.join(' ▀▄█'[pixel(frame, x, y) | pixel(frame, x, y + 1) << 1]
+                             for x in range(WIDTH)))
+    sys.stdout.write('\x1b[H' + '\n'.join(lines) + '\n')
+    sys.stdout.flush()
+
+
+def lzw(indices, min_code_size=2):
+    clear, end = 1 << min_code_size, (1 << min_code_size) + 1
+    out = bytearray()
+    bits = nbits = 0
+
+    def emit(code, size):
+        nonlocal bits, nbits
+        bits |= code << nbits
+        nbits += size
+        while nbits >= 8:
+            out.append(bits & 0xFF)
+            bits >>= 8
+            nbits -= 8
+
+    table = {bytes([i]): i for i in range(clear)}
+    size = min_code_size + 1
+    emit(clear, size)
+    prefix = b''
+    for index in indices:
+        candidate = prefix + bytes([index])
+        if candidate in table:
+            prefix = candidate
+            continue
+        emit(table[prefix], size)
+        if len(table) + 2 == 4096:
+            emit(clear, size)
+            table = {bytes([i]): i for i in range(clear)}
+            size = min_code_size + 1
+        else:
+            table[candidate] = len(table) + 2
+            if len(table) + 1 == 1 << size:
+                size += 1
+        prefix = bytes([index])
+    emit(table[prefix], size)
+    emit(end, size)
+    if nbits:
+        out.append(bits & 0xFF)
+    return bytes(out)
+
+
+def write_gif(path, frames, delay_ms):
+    with open(path, 'wb') as f:
+        f.write(b'GIF89a' + struct.pack('<HHBBB', WIDTH, HEIGHT, 0x80, 0, 0))
+        f.write(b'\x00\x00\x00\xff\xff\xff')
+        f.write(b'\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00')
+        for frame in frames:
+            f.write(struct.pack('<BBBBHBB', 0x21, 0xF9, 4, 0, delay_ms // 10, 0, 0))
+            f.write(struct.pack('<BHHHHB', 0x2C, 0, 0, WIDTH, HEIGHT, 0))
+            data = lzw([pixel(frame, x, y) for y in range(HEIGHT) for x in range(WIDTH)])
+            f.write(b'\x02')
+            for i in range(0, len(data), 255):
+                chunk = data[i:i + 255]
+                f.write(bytes([len(chunk)]) + chunk)
+            f.write(b'\x00')
+        f.write(b'\x3b')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--port', help='serial port to read live')
+    source.add_argument('--input', help='raw capture of the serial stream')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--capture', help='also save the raw stream here')
+    parser.add_argument('--show', action='store_true', help='draw frames in the terminal')
+    parser.add_argument('--pbm', help='directory to write one PBM per frame')
+    parser.add_argument('--gif', help='write an animated GIF when the stream ends')
+    parser.add_argument('--delay', type=int, default=50, help='GIF frame delay in ms')
+    args = parser.parse_args()
+
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud, timeout=0.1)
+    else:
+        stream = open(args.input, 'rb')
+    capture = open(args.capture, 'wb') if args.capture else None
+    if args.pbm:
+        os.makedirs(args.pbm, exist_ok=True)
+    if args.show:
+        sys.stdout.write('\x1b[2J')
+
+    decoder = Decoder()
+    gif_frames = []
+    try:
+        while True:
+            data = stream.read(4096)
+            if not data:
+                if args.input:
+                    break
+                continue
+            if capture:
+                capture.write(data)
+            for frame in decoder.feed(data):
+                if args.show:
+                    show(frame)
+                if args.pbm:
+                    with open(os.path.join(args.pbm, 'frame_%05d.pbm' % decoder.frames), 'wb') as f:
+                        f.write(to_pbm(frame))
+                if args.gif:
+                    gif_frames.append(frame)
+    except KeyboardInterrupt:
+        pass
+
+    if args.gif and gif_frames:
+        write_gif(args.gif, gif_frames, args.delay)
+    if decoder.frames:
+        per_frame = decoder.packet_bytes / decoder.frames
+        print('%d frames, %.1f bytes/frame (%.1f%% of %d raw), %d packets lost' % (
+            decoder.frames, per_frame, 100 * per_frame / FRAME_SIZE, FRAME_SIZE, decoder.dropped),
+            file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "flash_emu.h"
+
+static FILE* file;
+static uint8_t* image;
+static esp_partition_t partition = { .label = "scores" };
+static int64_t cut_budget = -1;
+static flash_emu_stats stats;
+
+int flash_emu_open(const char* path, uint32_t size, uint32_t sector_size)
+{
+    image = malloc(size);
+    memset(image, 0xFF, size);
+    file = fopen(path, "r+b");
+    if(file)
+    {
+        if(fread(image, 1, size, file) != size)
+            fprintf(stderr, "%s: shorter than %u bytes, rest reads as erased\n", path, size);
+    }
+    else
+    {
+        file = fopen(path, "w+b");
+        if(!file)
+            return -1;
+        fwrite(image, 1, size, file);
+    }
+    fflush(file);
+
+    partition.size = size;
+    partition.erase_size = sector_size;
+    return 0;
+}
+
+void flash_emu_cut_after(int64_t bytes)
+{
+    cut_budget = bytes;
+}
+
+const flash_emu_stats* flash_emu_get_stats(void)
+{
+    return &stats;
+}
+
+static void persist(size_t offset, size_t size)
+{
+    fseek(file, offset, SEEK_SET);
+    fwrite(image + offset, 1, size, file);
+    fflush(file);
+}
+
+static void power_cut(size_t offset, size_t size)
+{
+    persist(offset, size);
+    fprintf(stderr, "power cut at offset 0x%zx\n", offset + size);
+    exit(2);
+}
+
+const esp_partition_t* esp_partition_find_first(int type, int subtype, const char* label)
+{
+    return (image && !strcmp(label, partition.label)) ? &partition : NULL;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t* p, size_t offset, size_t size,
+    int memory, const void** out_ptr, esp_partition_mmap_handle_t* out_handle)
+{
+    if(offset + size > p->size)
+        return ESP_ERR_INVALID_ARG;
+    *out_ptr = image + offset;
+    *out_handle = 0;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* p, size_t offset, const void* src, size_t size)
+{
+    if(offset + size > p->size)
+        return ESP_ERR_INVALID_SIZE;
+    const uint8_t* data = src;
+    for(size_t i = 0; i < size; i++)
+    {
+        if(cut_budget == 0)
+            power_cut(offset, i);
+        if(cut_budget > 0)
+            cut_budget--;
+        image[offset + i] &= data[i];
+    }
+    stats.bytes_written += size;
+    persist(offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* p, size_t offset, size_t size)
+{
+    if(offset % p->erase_size || size % p->erase_size || offset + size > p->size)
+        return ESP_ERR_INVALID_ARG;
+    if(cut_budget == 0)
+    {
+        //an interrupted erase leaves the sector half done
+        memset(image + offset, 0xFF, size / 2);
+        power_cut(offset, size);
+    }
+    memset(image + offset, 0xFF, size);
+    stats.erases++;
+    persist(offset, size);
+    return ESP_OK;
+}
+
+//table driven like the ROM implementation, so boot timings stay comparable
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len)
+{
+    static uint32_t table[256];
+    if(!table[1])
+        for(uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for(int k = 0; k < 8; k++)
+                c = (c >> 1) ^ (0xEDB88320 & -(c & 1));
+            table[i] = c;
+        }
+
+    crc = ~crc;
+    while(len--)
+        crc = table[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+// File-backed NOR flash behind the esp_partition API. Writes can only clear
+// bits, erases set a whole range back to 0xFF, and every change goes straight
+// to the backing file so a killed process leaves the image a real board would.
+
+typedef struct flash_emu_stats
+{
+    uint64_t bytes_written;
+    uint32_t erases;
+} flash_emu_stats;
+
+int flash_emu_open(const char* path, uint32_t size, uint32_t sector_size);
+
+// Power is cut once this many more bytes have been written, mid-write.
+void flash_emu_cut_after(int64_t bytes);
+
+const flash_emu_stats* flash_emu_get_stats(void);
@@ -0,0 +1,127 @@
+// Runs main/score_log.c against a file-backed flash image on the host.
+//
+//   gcc -O2 -Itools/host_shim -Imain -o score_log_sim
+//       tools/score_log_sim/*.c main/score_log.c
+//   ./score_log_sim scores.img --games 5000
+//   ./score_log_sim scores.img --games 100 --cut 20000   (power loss mid-write)
+//   ./score_log_sim scores.img                           (boot only, check recovery)
+//
+// Every game is appended whether it makes the leaderboard or not, the worst
+// case for garbage and boot time. Replays are derived from their seed so a
+// later boot can check every one it finds.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash_emu.h"
+#include "score_log.h"
+
+static snake_replay replay, loaded;
+
+static void make_replay(snake_replay* r, uint32_t seed, int max_steps)
+{
+    r->seed = seed;
+    r->complete = true;
+    r->step_count = max_steps ? seed % (max_steps + 1) : 0;
+    for(int i = 0; i < r->step_count; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        r->steps[i] = (seed >> 8) & 0xFFFF;
+    }
+}
+
+static int check_replays(int max_steps)
+{
+    const score_entry* top;
+    int count = score_log_top(&top);
+    int bad = 0;
+    for(int i = 0; i < count; i++)
+    {
+        if(!top[i].has_replay)
+            continue;
+        if(score_log_load_replay(&top[i], &loaded) != ESP_OK)
+        {
+            bad++;
+            continue;
+        }
+        make_replay(&replay, loaded.seed, max_steps);
+        if(loaded.step_count != replay.step_count ||
+            memcmp(loaded.steps, replay.steps, replay.step_count * sizeof(uint16_t)))
+            bad++;
+    }
+    return bad;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = NULL;
+    uint32_t size = 64 * 1024, sector_size = 4096;
+    int games = 0, max_steps = 256;
+    long cut = -1;
+    unsigned seed = 1;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "--games") && i + 1 < argc)
+            games = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--size") && i + 1 < argc)
+            size = strtoul(argv[++i], NULL, 0);
+        else if(!strcmp(argv[i], "--max-steps") && i + 1 < argc)
+            max_steps = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--cut") && i + 1 < argc)
+            cut = atol(argv[++i]);
+        else if(!strcmp(argv[i], "--seed") && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 0);
+        else if(argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+        {
+            fprintf(stderr, "usage: %s IMAGE [--games N] [--size BYTES] [--max-steps N] "
+                "[--cut BYTES] [--seed N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(!path || max_steps > SNAKE_REPLAY_MAX_STEPS)
+        return 1;
+
+    if(flash_emu_open(path, size, sector_size))
+    {
+        perror(path);
+        return 1;
+    }
+    if(score_log_init() != ESP_OK)
+        return 1;
+
+    const score_log_stats* stats = score_log_get_stats();
+    printf("boot: %u records indexed in %u us\n", stats->records, stats->boot_us);
+    int bad = check_replays(max_steps);
+    printf("boot: %d bad replays\n", bad);
+
+    srand(seed);
+    if(cut >= 0)
+        flash_emu_cut_after(cut);
+    for(int i = 0; i < games; i++)
+    {
+        make_replay(&replay, rand(), max_steps);
+        if(score_log_add(rand() % 10000, rand() % 4, &replay) != ESP_OK)
+            return 1;
+        if(score_log_needs_compaction())
+            score_log_compact();
+    }
+
+    if(games)
+    {
+        const flash_emu_stats* flash_stats = flash_emu_get_stats();
+        printf("appended %u bytes, wrote %llu bytes, write amplification %.2f, %u erases\n",
+            stats->user_bytes, (unsigned long long)flash_stats->bytes_written,
+            (double)flash_stats->bytes_written / stats->user_bytes, flash_stats->erases);
+    }
+
+    const score_entry* top;
+    int count = score_log_top(&top);
+    for(int i = 0; i < count; i++)
+        printf("%d. %5u  level %u  seq %u%s\n", i + 1, top[i].score, top[i].level, top[i].seq,
+            top[i].has_replay ? "  replay" : "");
+    return bad ? 3 : 0;
+}
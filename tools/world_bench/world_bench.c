@@ -0,0 +1,268 @@
+// Measures drawing cost for a long snake in a big world, on the host.
+//
+//   gcc -O2 -Imain -o world_bench tools/world_bench/world_bench.c main/world.c
+//   ./world_bench --length 2000 --frames 20000             (random walk, camera on the head)
+//   ./world_bench --length 2000 --frames 20000 --coiled    (body packed around the camera)
+//
+// Every frame the segments world_for_each_visible finds are checked against a
+// walk of the whole body through world_on_camera, they have to match. The snake is
+// laid out like snake.c does it, segments from a pool allocated up front, so the
+// bytes per segment are the real ones.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "world.h"
+
+#define VIEW_WIDTH 20
+#define VIEW_HEIGHT 10
+
+typedef struct bench_node
+{
+    world_entry cell;
+    struct bench_node* next;
+    struct bench_node* prev;
+    short int x;
+    short int y;
+    short int next_direction;
+    short int prev_direction;
+    bool eaten;
+} bench_node;
+
+static bench_node *head, *tail, *pool_free;
+static int length = 0;
+static world_camera camera = { 0, 0, VIEW_WIDTH, VIEW_HEIGHT };
+static const int dx[4] = { -1, 0, 1, 0 }, dy[4] = { 0, -1, 0, 1 };
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//one block for the whole snake plus the spare head, chained through next like snake.c
+static bool pool_init(int count)
+{
+    bench_node* pool = malloc(count * sizeof(bench_node));
+    if(!pool)
+        return false;
+    for(int i = 0; i < count; i++)
+        pool[i].next = i + 1 < count ? &pool[i + 1] : NULL;
+    pool_free = pool;
+    return true;
+}
+
+static void add_head(int x, int y)
+{
+    bench_node* node = pool_free;
+    pool_free = node->next;
+    node->x = world_wrap_x(x);
+    node->y = world_wrap_y(y);
+    node->next = head;
+    node->prev = NULL;
+    node->eaten = false;
+    if(head)
+        head->prev = node;
+    else
+        tail = node;
+    head = node;
+    world_set(node->x, node->y, true);
+    world_index_add(&node->cell, node->x, node->y);
+    length++;
+}
+
+static void pop_tail(void)
+{
+    bench_node* node = tail;
+    tail = node->prev;
+    tail->next = NULL;
+    world_set(node->x, node->y, false);
+    world_index_remove(&node->cell);
+    node->next = pool_free;
+    pool_free = node;
+    length--;
+}
+
+//a dead end would end the run, so the snake turns around and goes on from its tail
+static void reverse(void)
+{
+    for(bench_node* node = head; node; node = node->prev)
+    {
+        bench_node* next = node->next;
+        node->next = node->prev;
+        node->prev = next;
+    }
+    bench_node* old_head = head;
+    head = tail;
+    tail = old_head;
+}
+
+static int wrapped_distance(int from, int to, int size)
+{
+    int d = abs(from - to);
+    return d < size - d ? d : size - d;
+}
+
+//chases random targets around the world like a player chasing apples, never runs into
+//itself, false when both ends are boxed in
+static bool step(void)
+{
+    static int target_x = 0, target_y = 0;
+    if(head->x == target_x && head->y == target_y)
+    {
+        target_x = rand() % world_width();
+        target_y = rand() % world_height();
+    }
+    for(int attempt = 0; attempt < 2; attempt++)
+    {
+        int best = -1, best_distance = 0;
+        for(int d = 0; d < 4; d++)
+        {
+            int x = world_wrap_x(head->x + dx[d]), y = world_wrap_y(head->y + dy[d]);
+            int distance = wrapped_distance(x, target_x, world_width()) +
+                wrapped_distance(y, target_y, world_height());
+            if(!world_occupied(x, y) && (best < 0 || distance < best_distance))
+            {
+                best = d;
+                best_distance = distance;
+            }
+        }
+        if(best >= 0)
+        {
+            add_head(head->x + dx[best], head->y + dy[best]);
+            return true;
+        }
+        reverse();
+    }
+    return false;
+}
+
+static void count_drawn(world_entry* entry, int view_x, int view_y, void* drawn)
+{
+    (*(int*)drawn)++;
+}
+
+static int draw_culled(int* visited)
+{
+    int drawn = 0;
+    *visited = world_for_each_visible(&camera, 1, count_drawn, &drawn);
+    return drawn;
+}
+
+static int draw_full(void)
+{
+    int drawn = 0, view_x, view_y;
+    for(bench_node* node = head; node; node = node->next)
+        drawn += world_on_camera(&camera, node->x, node->y, 1, &view_x, &view_y);
+    return drawn;
+}
+
+int main(int argc, char** argv)
+{
+    int world = 256, target = 2000, frames = 20000;
+    bool coiled = false;
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "--world") && i + 1 < argc)
+            world = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--length") && i + 1 < argc)
+            target = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--frames") && i + 1 < argc)
+            frames = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--coiled"))
+            coiled = true;
+        else
+        {
+            fprintf(stderr, "usage: %s [--world N] [--length N] [--frames N] [--coiled]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(world < VIEW_WIDTH || world > WORLD_MAX_SIZE || target < 2 || target > world * world / 2)
+        return 1;
+
+    if(!pool_init(target + 1))
+    {
+        fprintf(stderr, "no memory for %d segments\n", target);
+        return 1;
+    }
+    srand(1);
+    world_reset(NULL, world, world);
+    if(coiled)
+    {
+        //rows back and forth in a square, the densest a snake can be
+        int side = 1;
+        while(side * side < target)
+            side++;
+        for(int i = 0; i < target; i++)
+        {
+            int row = i / side, col = (row % 2) ? side - 1 - i % side : i % side;
+            add_head(col, row);
+        }
+    }
+    else
+    {
+        add_head(world / 2, world / 2);
+        //crowded worlds can box the snake in for good, it then runs shorter than asked
+        for(long tries = 0; length < target && tries < 100L * target; tries++)
+            if(!step())
+                pop_tail();
+    }
+
+    double culled_ns = 0, full_ns = 0, tick_ns = 0;
+    long visited_total = 0, drawn_total = 0;
+    int visited_max = 0, mismatches = 0;
+    for(int frame = 0; frame < frames; frame++)
+    {
+        double start = now_ns();
+        if(coiled)
+        {
+            //pan the camera across the coil and the empty world around it
+            camera.x = world_wrap_x(frame * 3);
+            camera.y = world_wrap_y(frame);
+        }
+        else
+        {
+            //a boxed in snake only loses its tail until it is free again
+            step();
+            pop_tail();
+            camera.x = world_wrap_x(head->x - VIEW_WIDTH / 2);
+            camera.y = world_wrap_y(head->y - VIEW_HEIGHT / 2);
+        }
+        double mid = now_ns();
+        int visited;
+        int drawn = draw_culled(&visited);
+        double culled_end = now_ns();
+        int expected = draw_full();
+        double full_end = now_ns();
+
+        tick_ns += mid - start;
+        culled_ns += culled_end - mid;
+        full_ns += full_end - culled_end;
+        mismatches += drawn != expected;
+        visited_total += visited;
+        drawn_total += drawn;
+        if(visited > visited_max)
+            visited_max = visited;
+    }
+
+    //the bucket heads are pointers, 4 bytes each on the ESP32
+    size_t world_bytes = WORLD_MAX_CHUNKS * WORLD_CHUNK * sizeof(uint16_t) +
+        WORLD_MAX_CHUNKS * sizeof(world_entry*) +
+        WORLD_MINIMAP_SIZE * WORLD_MINIMAP_SIZE * sizeof(uint16_t);
+    size_t world_bytes_esp32 = world_bytes - WORLD_MAX_CHUNKS * (sizeof(world_entry*) - 4);
+    printf("%dx%d world, %d segments, %s, %d frames\n", world, world, length,
+        coiled ? "coiled" : "random walk", frames);
+    printf("memory: %zu bytes of world tables (%zu on ESP32), %zu bytes/segment with %zu byte "
+        "pointers, %zu bytes of segment pool\n", world_bytes, world_bytes_esp32, sizeof(bench_node),
+        sizeof(void*), (target + 1) * sizeof(bench_node));
+    printf("culled: %.0f ns/frame, %.1f segments visited (max %d), %.1f drawn\n",
+        culled_ns / frames, (double)visited_total / frames, visited_max,
+        (double)drawn_total / frames);
+    printf("full walk: %.0f ns/frame, %d segments visited\n", full_ns / frames, length);
+    printf("tick: %.0f ns/frame to move the snake and camera\n", tick_ns / frames);
+    printf("%d frames where culling disagreed with the full walk\n", mismatches);
+    return mismatches ? 3 : 0;
+}